@@ -1,159 +1,2471 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdatomic.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define POOL_SIZE   (1024 * 4)  
+#define POOL_MAX_SIZE  (1024LL * 1024 * 1024)  // address space reserved for growth by default
+#define SEGMENT_SIZE   (2 * 1024 * 1024)       // growth/trim unit for pools of at least this size
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
 #define BLOCK_SIZE  64
-#define BLOCK_COUNT (POOL_SIZE / BLOCK_SIZE)
+#define BENCH_POOL_SIZE (16 * 1024 * 1024)     // default pool for the benchmarks
+#define BUDDY_MAX_ORDER 30
+#define TCACHE_MAX_BLOCKS 4    // runs of 1..4 blocks are served from thread caches
+#define TCACHE_BATCH      16   // runs moved per refill/flush of a thread cache
+#define TCACHE_CAPACITY   (2 * TCACHE_BATCH)
+#define TCACHE_MIN_BLOCKS 4096 // smaller pools would be drained by a few caches
+#define COMPACT_REGION_BLOCKS 512  // compact_step works on one region of this size
+#define COMPACT_SCAN_REGIONS  16   // regions scored per compact_step
+#define STATS_SAMPLE_MASK 63       // one call in 64 is timed for the latency histograms
+#define LATENCY_BUCKETS   32       // bucket k counts calls that took [2^k, 2^(k+1)) ns
 
+// Logging is off unless pool_verbose is set, and -DPOOL_NO_LOG removes it
+// from the build entirely.
+#ifdef POOL_NO_LOG
+#define POOL_LOG(...) do { } while (0)
+#else
+#define POOL_LOG(...) do { if (__builtin_expect(pool_verbose, 0)) printf(__VA_ARGS__); } while (0)
+#endif
+
+typedef enum {
+    FIRST_FIT,
+    NEXT_FIT
+} FitPolicy;
+
+typedef int MemHandle;  // 0 is never a valid handle
+
+typedef struct {
+    int block;  // first block of the allocation, or next free entry when unused
+    int pins;   // -1 when the entry is unused
+} HandleEntry;
+
+typedef enum {
+    ENGINE_CONTIGUOUS,  // first-fit/next-fit runs of blocks
+    ENGINE_BUDDY        // binary buddy system over power-of-two runs
+} AllocEngine;
+
+typedef enum {
+    HUGE_PAGES_OFF,
+    HUGE_PAGES_TRANSPARENT,  // madvise(MADV_HUGEPAGE) on the arena
+    HUGE_PAGES_EXPLICIT      // MAP_HUGETLB, falls back to transparent
+} HugePageMode;
+
+typedef struct {
+    AllocEngine engine;
+    size_t initial_size;    // committed by init
+    size_t max_size;        // address space reserved for growth
+    size_t segment_size;    // growth and trim unit, 0 picks one from initial_size
+    HugePageMode huge_pages;
+} PoolConfig;
+
+typedef enum {
+    OP_MALLOC,
+    OP_FREE,
+    OP_REALLOC,
+    OP_COMPACT,
+    OP_KINDS
+} PoolOp;
+
+// Counters of one thread. Only the owning thread writes them, so relaxed
+// loads and stores are enough and the hot path has no atomic
+// read-modify-write. bytes_in_use wraps when other threads free this
+// thread's memory; the sum over all threads is still exact.
+typedef struct {
+    _Atomic uint64_t calls[OP_KINDS];
+    _Atomic uint64_t failures;
+    _Atomic uint64_t bytes_in_use;
+    _Atomic uint64_t latency[OP_KINDS][LATENCY_BUCKETS];
+    unsigned int sample_tick;
+} ThreadStats;
+
+typedef struct {
+    uint64_t calls[OP_KINDS];
+    uint64_t failures;                 // my_malloc and my_realloc calls that returned NULL
+    int64_t bytes_in_use;              // held by callers
+    size_t bytes_reserved;             // taken from the pool, including thread-cached runs
+    size_t peak_reserved;
+    size_t pool_bytes;                 // committed
+    size_t free_bytes;
+    size_t largest_free_run;           // in bytes
+    double external_fragmentation;     // 1 - largest_free_run / free_bytes
+    uint64_t compaction_bytes_moved;
+    uint64_t latency[OP_KINDS][LATENCY_BUCKETS];  // sampled, see STATS_SAMPLE_MASK
+} PoolStats;
+
+// The arena and every per-block table are reserved up front for
+// capacity_blocks with mmap, so growing never moves them and untouched pages
+// never become resident. Blocks [0, block_count) are committed. block_count
+// changes under pool_lock; the paths that read it without the lock load it
+// with acquire.
 static unsigned char *memory_pool = NULL;
-static char block_owner[BLOCK_COUNT]; 
-static void* ptr_to_block[BLOCK_COUNT];
+static unsigned char* arena_base = NULL; // start of the arena mapping, memory_pool is aligned inside it
+static size_t arena_bytes = 0;
+static int capacity_blocks = 0;
+static _Atomic int block_count = 0;
+static int segment_blocks = 0;
+static unsigned char* segment_idle = NULL;  // 1 = segment was returned to the OS with madvise
+static char* block_owner = NULL;
+static int* alloc_blocks = NULL;         // block count of the allocation starting here, 0 otherwise
+static uint64_t* free_map = NULL;        // bit set = block is free
+static int* alloc_handle = NULL;         // handle of the allocation starting here, 0 for raw pointers
+static HandleEntry* handle_table = NULL;
+static int handle_free_head = 0;
+static int handle_next_unused = 1;       // handles above this were never handed out
+static int compact_cursor = 0;           // region where the next compact_step starts scoring
+static int compact_sweep = -1;           // hole a pool-wide slide fills next, -1 = none running
+static int compact_sweep_scan = 0;       // where it looks for the next run
+static FitPolicy fit_policy = FIRST_FIT;
+static int next_fit_cursor = 0;
+static AllocEngine alloc_engine = ENGINE_CONTIGUOUS;
+static int pool_verbose = 0;
+static int stats_enabled = 1;
+static int reserved_blocks = 0;          // blocks taken out of free_map by engine_alloc
+static int peak_reserved_blocks = 0;
+static uint64_t compaction_bytes_moved = 0;
+
+// Every central structure above is guarded by pool_lock. Thread caches hold
+// small runs that are already reserved in free_map (alloc_blocks < 0), so the
+// common my_malloc/my_free path never takes the lock.
+typedef struct ThreadCache {
+    unsigned int generation;
+    int count[TCACHE_MAX_BLOCKS];
+    int runs[TCACHE_MAX_BLOCKS][TCACHE_CAPACITY];
+    ThreadStats stats;
+    _Atomic int publishing;            // rewriting one of its runs without pool_lock
+    struct ThreadCache* next;          // registry of live threads for pool_get_stats
+} ThreadCache;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t tcache_key;
+static pthread_once_t tcache_key_once = PTHREAD_ONCE_INIT;
+static __thread ThreadCache* tcache = NULL;
+static unsigned int pool_generation = 0;  // bumped by init so caches drop stale runs
+static int tcache_enabled = 1;
+static ThreadCache* tcache_list = NULL;   // guarded by pool_lock
+static _Atomic int compaction_running = 0;
+static ThreadStats stats_retired;         // counters of threads that exited
+
+// Buddy free lists are intrusive doubly linked lists of block indices.
+static int buddy_head[BUDDY_MAX_ORDER + 1];
+static int* buddy_next = NULL;
+static int* buddy_prev = NULL;
+static signed char* buddy_free_order = NULL;  // order + 1 of a free buddy starting here, 0 otherwise
+static unsigned int buddy_nonempty;            // bit k set = list k is not empty
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bitmap_set_range(uint64_t* map, int start, int count) {
+    while (count > 0) {
+        int bit = start % 64;
+        int n = (64 - bit < count) ? 64 - bit : count;
+        uint64_t mask = (n == 64) ? ~0ULL : (((1ULL << n) - 1) << bit);
+        map[start / 64] |= mask;
+        start += n;
+        count -= n;
+    }
+}
+
+static void bitmap_clear_range(uint64_t* map, int start, int count) {
+    while (count > 0) {
+        int bit = start % 64;
+        int n = (64 - bit < count) ? 64 - bit : count;
+        uint64_t mask = (n == 64) ? ~0ULL : (((1ULL << n) - 1) << bit);
+        map[start / 64] &= ~mask;
+        start += n;
+        count -= n;
+    }
+}
+
+static int bitmap_range_free(const uint64_t* map, int start, int count) {
+    while (count > 0) {
+        int bit = start % 64;
+        int n = (64 - bit < count) ? 64 - bit : count;
+        uint64_t mask = (n == 64) ? ~0ULL : (((1ULL << n) - 1) << bit);
+        if ((map[start / 64] & mask) != mask) return 0;
+        start += n;
+        count -= n;
+    }
+    return 1;
+}
+
+// Returns the first index >= w whose word differs from value.
+static int bitmap_skip_words(const uint64_t* map, int w, int nwords, uint64_t value) {
+#ifdef __SSE2__
+    __m128i pattern = _mm_set1_epi64x((long long)value);
+    while (w + 2 <= nwords) {
+        __m128i v = _mm_loadu_si128((const __m128i*)&map[w]);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, pattern)) != 0xFFFF) break;
+        w += 2;
+    }
+#endif
+    while (w < nwords && map[w] == value) w++;
+    return w;
+}
+
+// Finds `needed` consecutive free blocks at or after `from`, scanning the
+// bitmap 64 blocks per step. Returns the first block of the run or -1.
+static int bitmap_find_run(const uint64_t* map, int nblocks, int from, int needed) {
+    int nwords = (nblocks + 63) / 64;
+    int run_start = -1;
+    int run_len = 0;
+
+    for (int w = from / 64; w < nwords; ) {
+        uint64_t word = map[w];
+        if (w == from / 64) word &= ~0ULL << (from % 64);
+
+        if (word == 0) {
+            run_len = 0;
+            w = bitmap_skip_words(map, w + 1, nwords, 0);
+            continue;
+        }
+        if (word == ~0ULL) {
+            if (run_len == 0) run_start = w * 64;
+            if (needed - run_len <= 64) return run_start;
+            int end = bitmap_skip_words(map, w + 1, nwords, ~0ULL);
+            if (needed - run_len <= (end - w) * 64) return run_start;
+            run_len += (end - w) * 64;
+            w = end;
+            continue;
+        }
+
+        int bit = 0;
+        while (bit < 64) {
+            uint64_t rest = word >> bit;
+            if (rest & 1) {
+                int ones = __builtin_ctzll(~rest);
+                if (run_len == 0) run_start = w * 64 + bit;
+                run_len += ones;
+                if (run_len >= needed) return run_start;
+                bit += ones;
+            } else {
+                run_len = 0;
+                if (rest == 0) break;
+                bit += __builtin_ctzll(rest);
+            }
+        }
+        w++;
+    }
+    return -1;
+}
+
+// Returns the first used block at or after `from`, or -1.
+static int bitmap_find_used(const uint64_t* map, int nblocks, int from) {
+    int nwords = (nblocks + 63) / 64;
+    for (int w = from / 64; w < nwords; w++) {
+        uint64_t used = ~map[w];
+        if (w == from / 64) used &= ~0ULL << (from % 64);
+        if (used) {
+            int index = w * 64 + __builtin_ctzll(used);
+            return index < nblocks ? index : -1;
+        }
+    }
+    return -1;
+}
+
+static int bitmap_largest_run(const uint64_t* map, int nblocks) {
+    int nwords = (nblocks + 63) / 64;
+    int best = 0, run = 0;
+    for (int w = 0; w < nwords; w++) {
+        uint64_t word = map[w];
+        if (word == ~0ULL) {
+            run += 64;
+            continue;
+        }
+        int bit = 0;
+        while (bit < 64) {
+            uint64_t rest = word >> bit;
+            if (rest & 1) {
+                int ones = __builtin_ctzll(~rest);
+                run += ones;
+                bit += ones;
+            } else {
+                if (run > best) best = run;
+                run = 0;
+                if (rest == 0) break;
+                bit += __builtin_ctzll(rest);
+            }
+        }
+    }
+    return run > best ? run : best;
+}
+
+static int bitmap_count_free(const uint64_t* map, int nblocks) {
+    int count = 0;
+    for (int w = 0; w < (nblocks + 63) / 64; w++) count += __builtin_popcountll(map[w]);
+    return count;
+}
+
+static int order_for_blocks(int blocks) {
+    int order = 0;
+    while ((1 << order) < blocks) order++;
+    return order;
+}
+
+static void buddy_push(int index, int order) {
+    buddy_free_order[index] = (signed char)(order + 1);
+    buddy_prev[index] = -1;
+    buddy_next[index] = buddy_head[order];
+    if (buddy_head[order] != -1) buddy_prev[buddy_head[order]] = index;
+    buddy_head[order] = index;
+    buddy_nonempty |= 1u << order;
+}
+
+static void buddy_unlink(int index, int order) {
+    buddy_free_order[index] = 0;
+    if (buddy_prev[index] != -1) buddy_next[buddy_prev[index]] = buddy_next[index];
+    else buddy_head[order] = buddy_next[index];
+    if (buddy_next[index] != -1) buddy_prev[buddy_next[index]] = buddy_prev[index];
+    if (buddy_head[order] == -1) buddy_nonempty &= ~(1u << order);
+}
+
+static void buddy_release(int index, int order);
+
+// Hands blocks [start, end) to the buddy lists as the largest aligned
+// power-of-two chunks, merging with free neighbours.
+static void buddy_add_range(int start, int end) {
+    while (start < end) {
+        int k = 0;
+        while (k < BUDDY_MAX_ORDER && start % (2 << k) == 0 && start + (2 << k) <= end) k++;
+        buddy_release(start, k);
+        start += 1 << k;
+    }
+}
+
+// Takes the smallest free buddy that fits and splits it down to `order`.
+static int buddy_alloc(int order) {
+    if (order > BUDDY_MAX_ORDER) return -1;
+    unsigned int candidates = buddy_nonempty >> order;
+    if (!candidates) return -1;
+    int k = order + __builtin_ctz(candidates);
+    int index = buddy_head[k];
+    buddy_unlink(index, k);
+    while (k > order) {
+        k--;
+        buddy_push(index + (1 << k), k);
+    }
+    return index;
+}
+
+// Returns a run to its free list, merging with its buddy while it is free.
+static void buddy_release(int index, int order) {
+    while (order < BUDDY_MAX_ORDER) {
+        int buddy = index ^ (1 << order);
+        if (buddy >= block_count || buddy_free_order[buddy] != order + 1) break;
+        buddy_unlink(buddy, order);
+        if (buddy < index) index = buddy;
+        order++;
+    }
+    buddy_push(index, order);
+}
+
+void set_fit_policy(FitPolicy policy) {
+    fit_policy = policy;
+    next_fit_cursor = 0;
+}
+
+static int grow_pool(int blocks);
+
+// Blocks [start, start + blocks) are about to hold data again, so pool_trim
+// must look at their segments next time. Caller holds pool_lock.
+static void segments_in_use(int start, int blocks) {
+    for (int seg = start / segment_blocks; seg <= (start + blocks - 1) / segment_blocks; seg++)
+        segment_idle[seg] = 0;
+}
+
+// Reserves a run for `*blocks` blocks and stores the reserved size back.
+// Caller holds pool_lock.
+static int engine_alloc(int* blocks) {
+    int start_index;
+    if (alloc_engine == ENGINE_BUDDY) {
+        int order = order_for_blocks(*blocks);
+        start_index = buddy_alloc(order);
+        *blocks = 1 << order;
+    } else if (fit_policy == NEXT_FIT) {
+        start_index = bitmap_find_run(free_map, block_count, next_fit_cursor, *blocks);
+        if (start_index == -1 && next_fit_cursor > 0)
+            start_index = bitmap_find_run(free_map, block_count, 0, *blocks);
+    } else {
+        start_index = bitmap_find_run(free_map, block_count, 0, *blocks);
+    }
+    if (start_index == -1) {
+        // Out of committed blocks: add segments and try again.
+        return grow_pool(*blocks) ? engine_alloc(blocks) : -1;
+    }
+
+    bitmap_clear_range(free_map, start_index, *blocks);
+    reserved_blocks += *blocks;
+    if (reserved_blocks > peak_reserved_blocks) peak_reserved_blocks = reserved_blocks;
+    next_fit_cursor = (start_index + *blocks) % block_count;
+    segments_in_use(start_index, *blocks);
+    return start_index;
+}
+
+// Caller holds pool_lock.
+static void engine_release(int start_index, int blocks) {
+    bitmap_set_range(free_map, start_index, blocks);
+    reserved_blocks -= blocks;
+    if (alloc_engine == ENGINE_BUDDY)
+        buddy_release(start_index, order_for_blocks(blocks));
+}
+
+static void tcache_flush(ThreadCache* tc, int cls, int keep) {
+    pthread_mutex_lock(&pool_lock);
+    while (tc->count[cls] > keep) {
+        int start_index = tc->runs[cls][--tc->count[cls]];
+        int blocks = -alloc_blocks[start_index];
+        alloc_blocks[start_index] = 0;
+        engine_release(start_index, blocks);
+    }
+    pthread_mutex_unlock(&pool_lock);
+}
+
+static void stats_fold(ThreadStats* into, ThreadStats* from) {
+    for (int op = 0; op < OP_KINDS; op++) {
+        into->calls[op] += atomic_load_explicit(&from->calls[op], memory_order_relaxed);
+        for (int k = 0; k < LATENCY_BUCKETS; k++)
+            into->latency[op][k] += atomic_load_explicit(&from->latency[op][k], memory_order_relaxed);
+    }
+    into->failures += atomic_load_explicit(&from->failures, memory_order_relaxed);
+    into->bytes_in_use += atomic_load_explicit(&from->bytes_in_use, memory_order_relaxed);
+}
+
+static void tcache_destroy(void* arg) {
+    ThreadCache* tc = arg;
+    if (tc->generation == pool_generation && memory_pool) {
+        for (int cls = 0; cls < TCACHE_MAX_BLOCKS; cls++) tcache_flush(tc, cls, 0);
+    }
+    pthread_mutex_lock(&pool_lock);
+    stats_fold(&stats_retired, &tc->stats);
+    ThreadCache** link = &tcache_list;
+    while (*link != tc) link = &(*link)->next;
+    *link = tc->next;
+    pthread_mutex_unlock(&pool_lock);
+    free(tc);
+}
+
+static void tcache_make_key() {
+    pthread_key_create(&tcache_key, tcache_destroy);
+}
+
+static ThreadCache* tcache_get() {
+    if (!tcache) {
+        pthread_once(&tcache_key_once, tcache_make_key);
+        tcache = calloc(1, sizeof(ThreadCache));
+        if (!tcache) return NULL;
+        tcache->generation = pool_generation;
+        pthread_setspecific(tcache_key, tcache);
+        pthread_mutex_lock(&pool_lock);
+        tcache->next = tcache_list;
+        tcache_list = tcache;
+        pthread_mutex_unlock(&pool_lock);
+    }
+    if (tcache->generation != pool_generation) {
+        memset(tcache->count, 0, sizeof(tcache->count));
+        tcache->generation = pool_generation;
+    }
+    return tcache;
+}
+
+// Pops a cached run of `blocks` blocks, refilling a whole batch under one
+// lock acquisition when the cache is empty. Returns -1 if the pool is full.
+static int tcache_pop(int blocks) {
+    ThreadCache* tc = tcache_get();
+    if (!tc) return -1;
+    int cls = blocks - 1;
+    if (tc->count[cls] == 0) {
+        pthread_mutex_lock(&pool_lock);
+        while (tc->count[cls] < TCACHE_BATCH) {
+            int reserved = blocks;
+            int start_index = engine_alloc(&reserved);
+            if (start_index == -1) break;
+            alloc_blocks[start_index] = -reserved;
+            tc->runs[cls][tc->count[cls]++] = start_index;
+        }
+        pthread_mutex_unlock(&pool_lock);
+        if (tc->count[cls] == 0) return -1;
+    }
+    return tc->runs[cls][--tc->count[cls]];
+}
+
+// A thread cache rewrites alloc_blocks and block_owner of its own run
+// without pool_lock. Compaction must not read or move that run halfway, so
+// it raises compaction_running and waits until no cache is publishing; a
+// thread that sees the flag takes pool_lock instead and waits for the
+// compaction to end. Both sides store their flag before loading the other
+// one (seq_cst), so at least one of them sees the other. Returns 1 if the
+// section holds pool_lock. No pool_lock may be taken inside the section.
+static int run_publish_begin(ThreadCache* tc) {
+    atomic_store(&tc->publishing, 1);
+    if (!atomic_load(&compaction_running)) return 0;
+    atomic_store_explicit(&tc->publishing, 0, memory_order_release);
+    pthread_mutex_lock(&pool_lock);
+    return 1;
+}
+
+static void run_publish_end(ThreadCache* tc, int locked) {
+    if (locked)
+        pthread_mutex_unlock(&pool_lock);
+    else
+        atomic_store_explicit(&tc->publishing, 0, memory_order_release);
+}
+
+// Caller holds pool_lock. Keeps fast paths out of the tables until
+// compaction_end.
+static void compaction_begin() {
+    atomic_store(&compaction_running, 1);
+    for (ThreadCache* tc = tcache_list; tc; tc = tc->next)
+        while (atomic_load(&tc->publishing)) sched_yield();
+}
+
+static void compaction_end() {
+    atomic_store_explicit(&compaction_running, 0, memory_order_release);
+}
+
+// Hands a run popped from the cache to process_id: owner bytes first, then
+// the positive size that makes it a movable allocation.
+static int tcache_take(int start_index, char process_id) {
+    ThreadCache* tc = tcache_get();
+    int locked = run_publish_begin(tc);
+    int blocks = -alloc_blocks[start_index];
+    memset(&block_owner[start_index], process_id, blocks);
+    alloc_blocks[start_index] = blocks;
+    run_publish_end(tc, locked);
+    return blocks;
+}
+
+static int tcache_push(int start_index, int blocks) {
+    ThreadCache* tc = tcache_get();
+    if (!tc) return 0;
+    int cls = blocks - 1;
+    if (tc->count[cls] == TCACHE_CAPACITY) tcache_flush(tc, cls, TCACHE_BATCH);
+    int locked = run_publish_begin(tc);
+    memset(&block_owner[start_index], 0, blocks);
+    alloc_blocks[start_index] = -blocks;
+    run_publish_end(tc, locked);
+    tc->runs[cls][tc->count[cls]++] = start_index;
+    return 1;
+}
+
+void set_thread_cache(int enabled) {
+    tcache_enabled = enabled;
+}
+
+static int tcache_usable(int blocks) {
+    return tcache_enabled && atomic_load_explicit(&block_count, memory_order_acquire) >= TCACHE_MIN_BLOCKS &&
+           blocks <= TCACHE_MAX_BLOCKS;
+}
+
+// Statistics live in the thread cache, so recording a call costs a few
+// thread-local stores. Latency is measured for one call in
+// STATS_SAMPLE_MASK + 1 to keep clock reads off most calls.
+void set_pool_stats(int enabled) {
+    stats_enabled = enabled;
+}
+
+static void stat_add(_Atomic uint64_t* counter, uint64_t n) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
+
+static int latency_bucket(double ns) {
+    uint64_t v = ns < 1 ? 1 : (uint64_t)ns;
+    int k = 63 - __builtin_clzll(v);
+    return k < LATENCY_BUCKETS ? k : LATENCY_BUCKETS - 1;
+}
+
+static ThreadCache* stats_thread() {
+    return stats_enabled ? tcache_get() : NULL;
+}
+
+// Returns the start time when this call is sampled, 0 otherwise.
+static double stats_begin(ThreadCache* tc) {
+    if (!tc) return 0;
+    return (tc->stats.sample_tick++ & STATS_SAMPLE_MASK) == 0 ? now_ns() : 0;
+}
+
+static void stats_end(ThreadCache* tc, PoolOp op, double t0, int ok, int64_t bytes) {
+    if (!tc) return;
+    ThreadStats* st = &tc->stats;
+    if (ok) {
+        stat_add(&st->calls[op], 1);
+        stat_add(&st->bytes_in_use, (uint64_t)bytes);
+    } else {
+        stat_add(&st->failures, 1);
+    }
+    if (t0 > 0) stat_add(&st->latency[op][latency_bucket(now_ns() - t0)], 1);
+}
+
+// Caller holds pool_lock.
+static void stats_reset() {
+    for (ThreadCache* tc = tcache_list; tc; tc = tc->next)
+        memset(&tc->stats, 0, sizeof(tc->stats));
+    memset(&stats_retired, 0, sizeof(stats_retired));
+    reserved_blocks = peak_reserved_blocks = 0;
+    compaction_bytes_moved = 0;
+}
+
+static size_t round_up(size_t value, size_t unit) {
+    return (value + unit - 1) / unit * unit;
+}
+
+// Anonymous mappings are zero-filled on first touch, so the tables need no
+// memset and only the parts that are used ever become resident.
+static void* reserve_table(size_t bytes) {
+    void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+        printf("Error: Failed to reserve %zu bytes of allocator metadata\n", bytes);
+        exit(1);
+    }
+    return p;
+}
+
+static void release_table(void* p, size_t bytes) {
+    if (p) munmap(p, bytes);
+}
+
+// Reserves the arena without committing it. With huge pages the arena is
+// aligned to HUGE_PAGE_SIZE so whole huge pages back the segments.
+static unsigned char* reserve_arena(size_t bytes, HugePageMode mode) {
+    if (mode == HUGE_PAGES_EXPLICIT) {
+        // No MAP_NORESERVE: without reserved huge pages the mmap fails here
+        // instead of faulting later.
+        void* p = mmap(NULL, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            arena_base = p;
+            arena_bytes = bytes;
+            return p;
+        }
+        mode = HUGE_PAGES_TRANSPARENT;
+    }
+
+    size_t slack = (mode == HUGE_PAGES_TRANSPARENT) ? HUGE_PAGE_SIZE : 0;
+    unsigned char* p = mmap(NULL, bytes + slack, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+    arena_base = p;
+    arena_bytes = bytes + slack;
+    if (!slack) return p;
+
+    unsigned char* aligned = (unsigned char*)round_up((uintptr_t)p, HUGE_PAGE_SIZE);
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, bytes, MADV_HUGEPAGE);
+#endif
+    return aligned;
+}
+
+// Commits blocks [block_count, new_count). Caller holds pool_lock (or is init).
+static int commit_blocks(int new_count) {
+    size_t from = (size_t)block_count * BLOCK_SIZE;
+    size_t to = (size_t)new_count * BLOCK_SIZE;
+    if (mprotect(memory_pool + from, to - from, PROT_READ | PROT_WRITE) != 0) return 0;
+
+    int old_count = block_count;
+    atomic_store_explicit(&block_count, new_count, memory_order_release);
+    bitmap_set_range(free_map, old_count, new_count - old_count);
+    if (alloc_engine == ENGINE_BUDDY) buddy_add_range(old_count, new_count);
+    return 1;
+}
+
+// Adds enough segments for a run of `blocks` blocks. Caller holds pool_lock.
+static int grow_pool(int blocks) {
+    if (block_count >= capacity_blocks) return 0;
+    // Grow geometrically so a growing workload needs O(log n) commits.
+    int step = blocks > block_count ? blocks : block_count;
+    int new_count = (int)round_up((size_t)block_count + step, segment_blocks);
+    if (new_count > capacity_blocks) new_count = capacity_blocks;
+    int old_count = block_count;
+    if (!commit_blocks(new_count)) return 0;
+    POOL_LOG("Pool grown from %d to %d blocks\n", old_count, new_count);
+    return 1;
+}
+
+void init_memory_config(const PoolConfig* config) {
+    alloc_engine = config->engine;
+    pool_generation++;
+
+    size_t segment = config->segment_size;
+    if (segment == 0) segment = config->initial_size >= SEGMENT_SIZE ? SEGMENT_SIZE : (size_t)getpagesize();
+    // Explicit huge pages can only be committed and trimmed in whole pages.
+    size_t unit = (config->huge_pages == HUGE_PAGES_EXPLICIT) ? HUGE_PAGE_SIZE : BLOCK_SIZE;
+    segment = round_up(segment, unit);
+    size_t initial = round_up(config->initial_size ? config->initial_size : POOL_SIZE, unit);
+    size_t max_size = config->max_size > initial ? config->max_size : initial;
+    max_size = round_up(max_size, segment);
+
+    memory_pool = reserve_arena(max_size, config->huge_pages);
+    if (!memory_pool) {
+        printf("Error: Failed to allocate memory pool from OS\n");
+        exit(1);
+    }
+    capacity_blocks = (int)(max_size / BLOCK_SIZE);
+    segment_blocks = (int)(segment / BLOCK_SIZE);
+    block_count = 0;
+
+    segment_idle = reserve_table(capacity_blocks / segment_blocks + 1);
+    block_owner = reserve_table(capacity_blocks);
+    alloc_blocks = reserve_table(capacity_blocks * sizeof(int));
+    alloc_handle = reserve_table(capacity_blocks * sizeof(int));
+    handle_table = reserve_table((capacity_blocks + 1) * sizeof(HandleEntry));
+    free_map = reserve_table((capacity_blocks + 63) / 64 * sizeof(uint64_t));
+    buddy_next = reserve_table(capacity_blocks * sizeof(int));
+    buddy_prev = reserve_table(capacity_blocks * sizeof(int));
+    buddy_free_order = reserve_table(capacity_blocks);
+    for (int k = 0; k <= BUDDY_MAX_ORDER; k++) buddy_head[k] = -1;
+    buddy_nonempty = 0;
+
+    handle_free_head = 0;
+    handle_next_unused = 1;
+    compact_cursor = 0;
+    compact_sweep = -1;
+    compact_sweep_scan = 0;
+    next_fit_cursor = 0;
+    pthread_mutex_lock(&pool_lock);
+    stats_reset();
+    pthread_mutex_unlock(&pool_lock);
+
+    if (!commit_blocks((int)(initial / BLOCK_SIZE))) {
+        printf("Error: Failed to allocate memory pool from OS\n");
+        exit(1);
+    }
+    POOL_LOG("Memory pool allocated from OS: %d blocks of %d bytes (total %zu KB)%s\n",
+             block_count, BLOCK_SIZE, initial / 1024,
+             alloc_engine == ENGINE_BUDDY ? ", buddy allocator" : "");
+}
+
+void init_memory_engine(AllocEngine engine) {
+    PoolConfig config = {engine, POOL_SIZE, POOL_MAX_SIZE, 0, HUGE_PAGES_TRANSPARENT};
+    init_memory_config(&config);
+}
+
+void init_memory() {
+    init_memory_engine(ENGINE_CONTIGUOUS);
+}
+
+void cleanup_memory() {
+    munmap(arena_base, arena_bytes);
+    release_table(segment_idle, capacity_blocks / segment_blocks + 1);
+    release_table(block_owner, capacity_blocks);
+    release_table(alloc_blocks, capacity_blocks * sizeof(int));
+    release_table(alloc_handle, capacity_blocks * sizeof(int));
+    release_table(handle_table, (capacity_blocks + 1) * sizeof(HandleEntry));
+    release_table(free_map, (capacity_blocks + 63) / 64 * sizeof(uint64_t));
+    release_table(buddy_next, capacity_blocks * sizeof(int));
+    release_table(buddy_prev, capacity_blocks * sizeof(int));
+    release_table(buddy_free_order, capacity_blocks);
+    memory_pool = NULL;
+    block_count = capacity_blocks = 0;
+    POOL_LOG("Memory returned to OS.\n");
+}
+
+// Returns fully free segments to the OS with MADV_DONTNEED. Their address
+// range stays committed and reads back as zeros when reused.
+size_t pool_trim() {
+    size_t released = 0;
+    pthread_mutex_lock(&pool_lock);
+    for (int seg = 0; seg * segment_blocks < block_count; seg++) {
+        int start = seg * segment_blocks;
+        int blocks = block_count - start < segment_blocks ? block_count - start : segment_blocks;
+        if (segment_idle[seg] || !bitmap_range_free(free_map, start, blocks)) continue;
+        size_t bytes = (size_t)blocks * BLOCK_SIZE;
+        if (madvise(memory_pool + (size_t)start * BLOCK_SIZE, bytes, MADV_DONTNEED) == 0) {
+            segment_idle[seg] = 1;
+            released += bytes;
+        }
+    }
+    pthread_mutex_unlock(&pool_lock);
+    if (released) POOL_LOG("Returned %zu KB of idle segments to the OS\n", released / 1024);
+    return released;
+}
+
+void* my_malloc(size_t size, char process_id) {
+    int blocks_needed = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (blocks_needed == 0) blocks_needed = 1;
+
+    ThreadCache* tc = stats_thread();
+    double t0 = stats_begin(tc);
+    int start_index = -1;
+    if (tcache_usable(blocks_needed)) {
+        start_index = tcache_pop(blocks_needed);
+        if (start_index != -1) blocks_needed = tcache_take(start_index, process_id);
+    } else {
+        pthread_mutex_lock(&pool_lock);
+        start_index = engine_alloc(&blocks_needed);
+        if (start_index != -1) {
+            memset(&block_owner[start_index], process_id, blocks_needed);
+            alloc_blocks[start_index] = blocks_needed;
+        }
+        pthread_mutex_unlock(&pool_lock);
+    }
+
+    if (start_index != -1) {
+        void* data_ptr = &memory_pool[start_index * BLOCK_SIZE];
+        stats_end(tc, OP_MALLOC, t0, 1, (int64_t)blocks_needed * BLOCK_SIZE);
+
+        POOL_LOG("Allocated %zu bytes (%d blocks) for process %c at blocks %d-%d\n",
+                 size, blocks_needed, process_id, start_index, start_index + blocks_needed - 1);
+        return data_ptr;
+    }
+
+    stats_end(tc, OP_MALLOC, t0, 0, 0);
+    POOL_LOG("Allocation failed for process %c: not enough contiguous blocks\n", process_id);
+    return NULL;
+}
+
+// Maps a pointer returned by my_malloc back to its first block, or -1.
+static int pointer_to_block(void* ptr) {
+    unsigned char* p = (unsigned char*)ptr;
+    size_t committed = (size_t)atomic_load_explicit(&block_count, memory_order_acquire) * BLOCK_SIZE;
+    if (!memory_pool || p < memory_pool || p >= memory_pool + committed) return -1;
+    size_t offset = (size_t)(p - memory_pool);
+    if (offset % BLOCK_SIZE != 0) return -1;
+    int index = (int)(offset / BLOCK_SIZE);
+    return alloc_blocks[index] > 0 ? index : -1;
+}
+
+void my_free(void* ptr) {
+    if (!ptr) return;
+
+    int start_index = pointer_to_block(ptr);
+    if (start_index == -1) {
+        POOL_LOG("Error: Pointer not found\n");
+        return;
+    }
+
+    if (alloc_handle[start_index]) {
+        POOL_LOG("Error: Pointer belongs to handle %d, use my_hfree\n", alloc_handle[start_index]);
+        return;
+    }
+
+    ThreadCache* tc = stats_thread();
+    double t0 = stats_begin(tc);
+    char pid = block_owner[start_index];
+    int blocks_freed = alloc_blocks[start_index];
+
+    if (!tcache_usable(blocks_freed) || !tcache_push(start_index, blocks_freed)) {
+        pthread_mutex_lock(&pool_lock);
+        memset(&block_owner[start_index], 0, blocks_freed);
+        alloc_blocks[start_index] = 0;
+        engine_release(start_index, blocks_freed);
+        pthread_mutex_unlock(&pool_lock);
+    }
+    stats_end(tc, OP_FREE, t0, 1, -(int64_t)blocks_freed * BLOCK_SIZE);
+
+    POOL_LOG("Freed %d blocks of process %c starting at block %d\n", 
+             blocks_freed, pid, start_index);
+}
+
+// Resizes in place when the blocks after the allocation are free, otherwise
+// moves the data to a new run. Returns NULL and keeps ptr valid on failure.
+void* my_realloc(void* ptr, size_t size) {
+    if (!ptr) {
+        POOL_LOG("Error: my_realloc needs an existing allocation, use my_malloc\n");
+        return NULL;
+    }
+    if (size == 0) {
+        my_free(ptr);
+        return NULL;
+    }
+
+    int start_index = pointer_to_block(ptr);
+    if (start_index == -1) {
+        POOL_LOG("Error: Pointer not found\n");
+        return NULL;
+    }
+    if (alloc_handle[start_index]) {
+        POOL_LOG("Error: Pointer belongs to handle %d and cannot be resized\n", alloc_handle[start_index]);
+        return NULL;
+    }
+
+    ThreadCache* tc = stats_thread();
+    double t0 = stats_begin(tc);
+    pthread_mutex_lock(&pool_lock);
+    char pid = block_owner[start_index];
+    int old_blocks = alloc_blocks[start_index];
+    int new_blocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    if (alloc_engine == ENGINE_BUDDY) {
+        // A buddy run can only be kept if the new size needs the same order.
+        if (order_for_blocks(new_blocks) == order_for_blocks(old_blocks)) {
+            pthread_mutex_unlock(&pool_lock);
+            stats_end(tc, OP_REALLOC, t0, 1, 0);
+            return ptr;
+        }
+    } else if (new_blocks <= old_blocks) {
+        int released = old_blocks - new_blocks;
+        memset(&block_owner[start_index + new_blocks], 0, released);
+        engine_release(start_index + new_blocks, released);
+        alloc_blocks[start_index] = new_blocks;
+        pthread_mutex_unlock(&pool_lock);
+        stats_end(tc, OP_REALLOC, t0, 1, -(int64_t)released * BLOCK_SIZE);
+        POOL_LOG("Resized process %c at block %d in place: %d -> %d blocks\n",
+                 pid, start_index, old_blocks, new_blocks);
+        return ptr;
+    }
+
+    int extra = new_blocks - old_blocks;
+    int tail = start_index + old_blocks;
+    if (alloc_engine == ENGINE_CONTIGUOUS && extra > 0 && tail + extra <= block_count &&
+        bitmap_range_free(free_map, tail, extra)) {
+        memset(&block_owner[tail], pid, extra);
+        bitmap_clear_range(free_map, tail, extra);
+        segments_in_use(tail, extra);
+        reserved_blocks += extra;
+        if (reserved_blocks > peak_reserved_blocks) peak_reserved_blocks = reserved_blocks;
+        alloc_blocks[start_index] = new_blocks;
+        pthread_mutex_unlock(&pool_lock);
+        stats_end(tc, OP_REALLOC, t0, 1, (int64_t)extra * BLOCK_SIZE);
+        POOL_LOG("Resized process %c at block %d in place: %d -> %d blocks\n",
+                 pid, start_index, old_blocks, new_blocks);
+        return ptr;
+    }
+
+    int reserved = new_blocks;
+    int new_index = engine_alloc(&reserved);
+    if (new_index == -1) {
+        pthread_mutex_unlock(&pool_lock);
+        stats_end(tc, OP_REALLOC, t0, 0, 0);
+        POOL_LOG("Allocation failed for process %c: not enough contiguous blocks\n", pid);
+        return NULL;
+    }
+    memset(&block_owner[new_index], pid, reserved);
+    alloc_blocks[new_index] = reserved;
+    memcpy(&memory_pool[new_index * BLOCK_SIZE], ptr,
+           (size_t)(old_blocks < reserved ? old_blocks : reserved) * BLOCK_SIZE);
+    memset(&block_owner[start_index], 0, old_blocks);
+    alloc_blocks[start_index] = 0;
+    engine_release(start_index, old_blocks);
+    pthread_mutex_unlock(&pool_lock);
+    stats_end(tc, OP_REALLOC, t0, 1, (int64_t)(reserved - old_blocks) * BLOCK_SIZE);
+
+    POOL_LOG("Moved process %c from blocks %d-%d to %d-%d (%d -> %d blocks)\n", pid,
+             start_index, start_index + old_blocks - 1, new_index, new_index + reserved - 1,
+             old_blocks, reserved);
+    return &memory_pool[new_index * BLOCK_SIZE];
+}
+
+// Allocates relocatable memory. The data is reached through handle_deref or
+// handle_pin, and compaction may move it while it is not pinned.
+MemHandle my_halloc(size_t size, char process_id) {
+    void* ptr = my_malloc(size, process_id);
+    if (!ptr) return 0;
+
+    int start_index = (int)(((unsigned char*)ptr - memory_pool) / BLOCK_SIZE);
+    pthread_mutex_lock(&pool_lock);
+    MemHandle h = handle_free_head;
+    if (h) handle_free_head = handle_table[h].block;
+    else h = handle_next_unused++;
+    handle_table[h].block = start_index;
+    handle_table[h].pins = 0;
+    alloc_handle[start_index] = h;
+    pthread_mutex_unlock(&pool_lock);
+    return h;
+}
+
+static int handle_valid(MemHandle h) {
+    return h > 0 && h < handle_next_unused && handle_table[h].pins >= 0;
+}
+
+void my_hfree(MemHandle h) {
+    if (h == 0) return;
+
+    ThreadCache* tc = stats_thread();
+    double t0 = stats_begin(tc);
+    pthread_mutex_lock(&pool_lock);
+    if (!handle_valid(h) || handle_table[h].pins > 0) {
+        pthread_mutex_unlock(&pool_lock);
+        POOL_LOG("Error: Handle %d is %s\n", h, handle_valid(h) ? "pinned" : "not allocated");
+        return;
+    }
+
+    int start_index = handle_table[h].block;
+    int blocks_freed = alloc_blocks[start_index];
+    char pid = block_owner[start_index];
+    memset(&block_owner[start_index], 0, blocks_freed);
+    alloc_blocks[start_index] = 0;
+    alloc_handle[start_index] = 0;
+    engine_release(start_index, blocks_freed);
+    handle_table[h].block = handle_free_head;
+    handle_table[h].pins = -1;
+    handle_free_head = h;
+    pthread_mutex_unlock(&pool_lock);
+    stats_end(tc, OP_FREE, t0, 1, -(int64_t)blocks_freed * BLOCK_SIZE);
+
+    POOL_LOG("Freed %d blocks of process %c starting at block %d\n", 
+             blocks_freed, pid, start_index);
+}
+
+// The returned pointer is only valid until the next compaction; pin the
+// handle to keep it stable.
+void* handle_deref(MemHandle h) {
+    if (!handle_valid(h)) return NULL;
+    return &memory_pool[handle_table[h].block * BLOCK_SIZE];
+}
+
+void* handle_pin(MemHandle h) {
+    pthread_mutex_lock(&pool_lock);
+    void* ptr = NULL;
+    if (handle_valid(h)) {
+        handle_table[h].pins++;
+        ptr = &memory_pool[handle_table[h].block * BLOCK_SIZE];
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return ptr;
+}
+
+void handle_unpin(MemHandle h) {
+    pthread_mutex_lock(&pool_lock);
+    if (handle_valid(h) && handle_table[h].pins > 0) handle_table[h].pins--;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+// Thread-cached runs and pinned handles cannot be moved by compaction.
+static int run_is_fixed(int start_index) {
+    int h = alloc_handle[start_index];
+    return alloc_blocks[start_index] < 0 || (h && handle_table[h].pins > 0);
+}
+
+static int run_length(int start_index) {
+    int blocks = alloc_blocks[start_index];
+    return blocks < 0 ? -blocks : blocks;
+}
+
+// Slides a run down to `to`; the blocks in between must be free.
+// Caller holds pool_lock.
+static void move_run(int from, int to, int run_blocks) {
+    char pid = block_owner[from];
+    int h = alloc_handle[from];
+
+    memmove(&memory_pool[to * BLOCK_SIZE], &memory_pool[from * BLOCK_SIZE], run_blocks * BLOCK_SIZE);
+    memset(&block_owner[from], 0, run_blocks);
+    memset(&block_owner[to], pid, run_blocks);
+    alloc_blocks[from] = 0;
+    alloc_blocks[to] = run_blocks;
+    alloc_handle[from] = 0;
+    alloc_handle[to] = h;
+    if (h) handle_table[h].block = to;
+    bitmap_set_range(free_map, from, run_blocks);
+    bitmap_clear_range(free_map, to, run_blocks);
+    segments_in_use(to, run_blocks);
+    compaction_bytes_moved += (uint64_t)run_blocks * BLOCK_SIZE;
+}
+
+void compact_memory() {
+    if (alloc_engine == ENGINE_BUDDY) {
+        // Buddy runs must stay aligned to their size; coalescing on free
+        // already merges free space, so there is nothing to slide.
+        POOL_LOG("\nCompaction skipped: buddy allocator coalesces on free\n");
+        return;
+    }
+    POOL_LOG("\nCompacting memory...\n");
+
+    int target_index = 0;
+    int moves = 0;
+    ThreadCache* tc = stats_thread();
+    double t0 = tc ? now_ns() : 0;
+
+    // Runs parked in thread caches and pinned handles stay where they are.
+    pthread_mutex_lock(&pool_lock);
+    compaction_begin();
+    for (int i = 0; i < block_count; ) {
+        if (alloc_blocks[i] == 0) {
+            i++;
+            continue;
+        }
+
+        int run_blocks = run_length(i);
+        if (run_is_fixed(i)) {
+            i += run_blocks;
+            target_index = i;
+            continue;
+        }
+
+        if (i != target_index) {
+            char pid = block_owner[i];
+            move_run(i, target_index, run_blocks);
+            moves++;
+            POOL_LOG("Moved process %c from blocks %d-%d to %d-%d\n", 
+                     pid, i, i + run_blocks - 1, target_index, target_index + run_blocks - 1);
+        }
+
+        target_index += run_blocks;
+        i += run_blocks;
+    }
+    compaction_end();
+    pthread_mutex_unlock(&pool_lock);
+    stats_end(tc, OP_COMPACT, t0, 1, 0);
+
+    POOL_LOG("Compaction complete. Moved %d processes\n", moves);
+}
+
+// Free blocks of a region that are not part of its largest free run.
+static int region_fragmentation(int region) {
+    int start = region * COMPACT_REGION_BLOCKS;
+    int blocks = block_count - start < COMPACT_REGION_BLOCKS ? block_count - start : COMPACT_REGION_BLOCKS;
+    const uint64_t* map = &free_map[start / 64];
+    return bitmap_count_free(map, blocks) - bitmap_largest_run(map, blocks);
+}
+
+// Slides unpinned handle allocations in [*target, end) down over the holes,
+// moving at most `max_blocks` blocks and looking at no more than
+// `max_blocks` runs. Runs are looked for from *scan, so the free space
+// gathered behind the slide is not scanned again. Leaves in *target and
+// *scan where to resume, *target = -1 once the range is done. Returns the
+// number of blocks moved.
+static int slide_runs(int* target, int* scan, int end, int max_blocks) {
+    int moved = 0, visited = 0;
+    int to = bitmap_find_run(free_map, end, *target, 1);
+    int from = to > *scan ? to : *scan;
+    while (to != -1) {
+        int next = bitmap_find_used(free_map, end, from);
+        if (next == -1) break;
+        int run_blocks = run_length(next);
+        if (++visited > max_blocks || (!run_is_fixed(next) && alloc_handle[next] != 0 &&
+                                       moved + run_blocks > max_blocks)) {
+            *target = to;
+            *scan = next;
+            return moved;
+        }
+
+        if (run_is_fixed(next) || alloc_handle[next] == 0) {
+            to = bitmap_find_run(free_map, end, next + run_blocks, 1);
+            from = to;
+            continue;
+        }
+        move_run(next, to, run_blocks);
+        moved += run_blocks;
+        to += run_blocks;
+        from = next + run_blocks;
+    }
+    *target = -1;
+    return moved;
+}
+
+// One bounded slice of incremental compaction. A slide over one region only
+// merges the holes inside it, leaving every region with free space at its
+// top, so once no region is fragmented a pool-wide slide runs in slices
+// and carries that free space to the end of the pool, as compact_memory
+// does. While it runs, regions are not scored: it fills their holes anyway.
+// Each slice moves at most max_blocks blocks and looks at as many runs, so
+// the pause does not grow with the pool.
+// Raw my_malloc pointers are never moved. Returns the number of blocks moved.
+int compact_step(int max_blocks) {
+    if (alloc_engine == ENGINE_BUDDY) return 0;
+
+    ThreadCache* tc = stats_thread();
+    double t0 = tc ? now_ns() : 0;
+
+    // block_count grows under pool_lock
+    pthread_mutex_lock(&pool_lock);
+    int regions = (block_count + COMPACT_REGION_BLOCKS - 1) / COMPACT_REGION_BLOCKS;
+    int scan = compact_sweep != -1 ? 0 : regions < COMPACT_SCAN_REGIONS ? regions : COMPACT_SCAN_REGIONS;
+    int best_region = -1;
+    int best_score = 0;
+    for (int k = 0; k < scan; k++) {
+        int region = (compact_cursor + k) % regions;
+        int score = region_fragmentation(region);
+        if (score > best_score) {
+            best_score = score;
+            best_region = region;
+        }
+    }
+    compact_cursor = (compact_cursor + scan) % regions;
+
+    compaction_begin();
+    int moved = 0;
+    if (best_region != -1) {
+        int start = best_region * COMPACT_REGION_BLOCKS, scan = start;
+        int end = start + COMPACT_REGION_BLOCKS < block_count ? start + COMPACT_REGION_BLOCKS : block_count;
+        moved = slide_runs(&start, &scan, end, max_blocks);
+    }
+    // A region whose holes sit behind pinned runs scores forever without
+    // moving anything; it must not keep the sweep from starting.
+    if (moved == 0) {
+        if (compact_sweep == -1) compact_sweep = compact_sweep_scan = 0;
+        moved = slide_runs(&compact_sweep, &compact_sweep_scan, block_count, max_blocks);
+        best_region = -1;
+    }
+    compaction_end();
+    pthread_mutex_unlock(&pool_lock);
+    stats_end(tc, OP_COMPACT, t0, 1, 0);
+
+    if (moved > 0 && best_region != -1)
+        POOL_LOG("Compaction step: moved %d blocks in region %d\n", moved, best_region);
+    else if (moved > 0)
+        POOL_LOG("Compaction step: moved %d blocks across regions\n", moved);
+    return moved;
+}
+
+void print_memory_map() {
+    printf("\nMemory map:\n");
+    for (int i = 0; i < block_count; i++) {
+        printf("%c", block_owner[i] ? block_owner[i] : '.');
+        if ((i + 1) % 64 == 0) printf("\n");
+    }
+    printf("\n");
+}
+
+// Sums the per-thread counters and measures free space. The free-space scan
+// is linear in the pool, so this is meant for monitoring, not the hot path.
+PoolStats pool_get_stats() {
+    PoolStats stats;
+    ThreadStats total;
+    memset(&stats, 0, sizeof(stats));
+    memset(&total, 0, sizeof(total));
+
+    pthread_mutex_lock(&pool_lock);
+    stats_fold(&total, &stats_retired);
+    for (ThreadCache* tc = tcache_list; tc; tc = tc->next) stats_fold(&total, &tc->stats);
+    int free_blocks = bitmap_count_free(free_map, block_count);
+    int largest = bitmap_largest_run(free_map, block_count);
+    stats.bytes_reserved = (size_t)reserved_blocks * BLOCK_SIZE;
+    stats.peak_reserved = (size_t)peak_reserved_blocks * BLOCK_SIZE;
+    stats.pool_bytes = (size_t)block_count * BLOCK_SIZE;
+    stats.compaction_bytes_moved = compaction_bytes_moved;
+    pthread_mutex_unlock(&pool_lock);
+
+    for (int op = 0; op < OP_KINDS; op++) {
+        stats.calls[op] = total.calls[op];
+        for (int k = 0; k < LATENCY_BUCKETS; k++) stats.latency[op][k] = total.latency[op][k];
+    }
+    stats.failures = total.failures;
+    stats.bytes_in_use = (int64_t)total.bytes_in_use;
+    stats.free_bytes = (size_t)free_blocks * BLOCK_SIZE;
+    stats.largest_free_run = (size_t)largest * BLOCK_SIZE;
+    stats.external_fragmentation = free_blocks ? 1.0 - (double)largest / free_blocks : 0.0;
+    return stats;
+}
+
+// Upper bound in ns of the bucket holding the given fraction of the samples.
+static uint64_t latency_percentile(const uint64_t* buckets, double fraction) {
+    uint64_t samples = 0;
+    for (int k = 0; k < LATENCY_BUCKETS; k++) samples += buckets[k];
+    if (samples == 0) return 0;
+    uint64_t seen = 0;
+    for (int k = 0; k < LATENCY_BUCKETS; k++) {
+        seen += buckets[k];
+        if (seen >= fraction * samples) return 2ULL << k;
+    }
+    return 2ULL << (LATENCY_BUCKETS - 1);
+}
+
+static const char* op_names[OP_KINDS] = {"malloc", "free", "realloc", "compact"};
+
+void print_pool_stats() {
+    PoolStats st = pool_get_stats();
+    printf("\nAllocator statistics:\n");
+    printf("  calls: %llu malloc, %llu free, %llu realloc, %llu compact, %llu failed\n",
+           (unsigned long long)st.calls[OP_MALLOC], (unsigned long long)st.calls[OP_FREE],
+           (unsigned long long)st.calls[OP_REALLOC], (unsigned long long)st.calls[OP_COMPACT],
+           (unsigned long long)st.failures);
+    printf("  in use %lld bytes, reserved %zu bytes, peak %zu bytes, pool %zu bytes\n",
+           (long long)st.bytes_in_use, st.bytes_reserved, st.peak_reserved, st.pool_bytes);
+    printf("  free %zu bytes, largest free run %zu bytes, external fragmentation %.2f\n",
+           st.free_bytes, st.largest_free_run, st.external_fragmentation);
+    printf("  compaction moved %llu bytes\n", (unsigned long long)st.compaction_bytes_moved);
+    for (int op = 0; op < OP_KINDS; op++) {
+        uint64_t samples = 0;
+        for (int k = 0; k < LATENCY_BUCKETS; k++) samples += st.latency[op][k];
+        if (samples == 0) continue;
+        printf("  %-8s latency p50 <= %llu ns, p99 <= %llu ns (%llu samples)\n", op_names[op],
+               (unsigned long long)latency_percentile(st.latency[op], 0.50),
+               (unsigned long long)latency_percentile(st.latency[op], 0.99),
+               (unsigned long long)samples);
+    }
+}
+
+// Writes the map as JSON: every allocated and free run plus the statistics.
+void dump_memory_map(FILE* out) {
+    PoolStats st = pool_get_stats();
+    fprintf(out, "{\"block_size\": %d, \"blocks\": %d, \"runs\": [", BLOCK_SIZE, block_count);
+
+    pthread_mutex_lock(&pool_lock);
+    const char* sep = "";
+    for (int i = 0; i < block_count; ) {
+        int blocks;
+        if (alloc_blocks[i] != 0) {
+            blocks = run_length(i);
+            char owner = block_owner[i];
+            int h = alloc_handle[i];
+            fprintf(out, "%s\n  {\"start\": %d, \"blocks\": %d, \"state\": \"%s\", \"owner\": ", sep, i, blocks,
+                    alloc_blocks[i] < 0 ? "cached" : h && handle_table[h].pins > 0 ? "pinned" : "used");
+            if (owner > ' ' && owner != '"' && owner != '\\' && owner < 127) fprintf(out, "\"%c\"", owner);
+            else fprintf(out, "null");
+            fprintf(out, ", \"handle\": %d}", h);
+        } else {
+            int next = bitmap_find_used(free_map, block_count, i);
+            blocks = (next == -1 ? block_count : next) - i;
+            fprintf(out, "%s\n  {\"start\": %d, \"blocks\": %d, \"state\": \"free\"}", sep, i, blocks);
+        }
+        sep = ",";
+        i += blocks;
+    }
+    pthread_mutex_unlock(&pool_lock);
 
-void init_memory() {
-    memory_pool = (unsigned char*)malloc(POOL_SIZE);
-    if (!memory_pool) {
-        printf("Error: Failed to allocate memory pool from OS\n");
-        exit(1);
+    fprintf(out, "\n], \"stats\": {\"failures\": %llu, \"bytes_in_use\": %lld, \"bytes_reserved\": %zu, "
+            "\"peak_reserved\": %zu, \"free_bytes\": %zu, \"largest_free_run\": %zu, "
+            "\"external_fragmentation\": %.4f, \"compaction_bytes_moved\": %llu",
+            (unsigned long long)st.failures, (long long)st.bytes_in_use, st.bytes_reserved,
+            st.peak_reserved, st.free_bytes, st.largest_free_run, st.external_fragmentation,
+            (unsigned long long)st.compaction_bytes_moved);
+    for (int op = 0; op < OP_KINDS; op++) {
+        fprintf(out, ", \"%s\": {\"calls\": %llu, \"latency_ns_log2\": [", op_names[op],
+                (unsigned long long)st.calls[op]);
+        for (int k = 0; k < LATENCY_BUCKETS; k++)
+            fprintf(out, "%s%llu", k ? ", " : "", (unsigned long long)st.latency[op][k]);
+        fprintf(out, "]}");
     }
-    memset(memory_pool, 0, POOL_SIZE);
-    memset(block_owner, 0, BLOCK_COUNT);
-    memset(ptr_to_block, 0, sizeof(ptr_to_block));
-    printf("Memory pool allocated from OS: %d blocks of %d bytes (total %d KB)\n",
-           BLOCK_COUNT, BLOCK_SIZE, POOL_SIZE / 1024);
+    fprintf(out, "}}\n");
 }
 
-void cleanup_memory() {
-    free(memory_pool);
-    memory_pool = NULL;
-    printf("Memory returned to OS.\n");
+void find_process_blocks(char pid) {
+    printf("Process %c occupies blocks: ", pid);
+    for (int i = 0; i < block_count; i++) {
+        if (block_owner[i] == pid) {
+            int start = i;
+            while (i < block_count && block_owner[i] == pid) i++;
+            printf("%d-%d ", start, i-1);
+        }
+    }
+    printf("\n");
 }
 
-void* my_malloc(size_t size, char process_id) {
-    int blocks_needed = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
-    
+// Shared-memory pool: the block bitmap, run table and data live in one POSIX
+// shared-memory object so cooperating processes allocate from it directly.
+// Blocks are claimed with compare-and-swap on bitmap words, so no lock is
+// shared between processes. Each run records the pid of its owner, which lets
+// shm_pool_recover reclaim runs of processes that died. Mappings differ per
+// process, so buffers are passed between processes as offsets.
+#define SHM_POOL_MAGIC 0x53484d50u
+
+typedef struct {
+    _Atomic uint32_t magic;            // stored last, with release, by the creator
+    int block_count;
+    size_t data_offset;                // from the start of the mapping
+    size_t mapping_size;
+} ShmPoolHeader;
+
+typedef struct {
+    ShmPoolHeader* header;
+    _Atomic uint64_t* free_map;        // bit set = block is free
+    _Atomic int32_t* owner_pid;        // pid owning the run starting here, 0 otherwise
+    _Atomic int32_t* run_blocks;       // blocks in the run starting here
+    unsigned char* data;
+    int block_count;
+    _Atomic int32_t search_hint;       // process-local next-fit start
+} ShmPool;
+
+static size_t shm_layout(int blocks, size_t* owner_off, size_t* runs_off, size_t* data_off) {
+    size_t map_off = round_up(sizeof(ShmPoolHeader), 64);
+    *owner_off = round_up(map_off + (size_t)(blocks + 63) / 64 * sizeof(uint64_t), 64);
+    *runs_off = round_up(*owner_off + (size_t)blocks * sizeof(int32_t), 64);
+    *data_off = round_up(*runs_off + (size_t)blocks * sizeof(int32_t), BLOCK_SIZE);
+    return *data_off + (size_t)blocks * BLOCK_SIZE;
+}
+
+// Creates (create != 0) or attaches to the pool called `name`. The creator
+// sizes and formats it; attaching processes read the size from the header.
+ShmPool* shm_pool_open(const char* name, size_t size, int create) {
+    int fd = shm_open(name, create ? (O_CREAT | O_EXCL | O_RDWR) : O_RDWR, 0600);
+    if (fd == -1) {
+        POOL_LOG("Error: shm_open(%s) failed: %s\n", name, strerror(errno));
+        return NULL;
+    }
+
+    int blocks = (int)(size / BLOCK_SIZE);
+    size_t owner_off, runs_off, data_off, total;
+    if (create) {
+        total = shm_layout(blocks, &owner_off, &runs_off, &data_off);
+        if (ftruncate(fd, (off_t)total) != 0) {
+            POOL_LOG("Error: Failed to size shared pool %s\n", name);
+            close(fd);
+            shm_unlink(name);
+            return NULL;
+        }
+    } else {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmPoolHeader)) {
+            close(fd);
+            return NULL;
+        }
+        total = (size_t)st.st_size;
+    }
+
+    unsigned char* base = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+
+    ShmPoolHeader* header = (ShmPoolHeader*)base;
+    if (create) {
+        // A fresh object is zero-filled: every run slot is already empty.
+        header->block_count = blocks;
+        header->data_offset = data_off;
+        header->mapping_size = total;
+        _Atomic uint64_t* map = (_Atomic uint64_t*)(base + round_up(sizeof(ShmPoolHeader), 64));
+        for (int i = 0; i < blocks; i += 64) {
+            int n = blocks - i < 64 ? blocks - i : 64;
+            atomic_store(&map[i / 64], n == 64 ? ~0ULL : (1ULL << n) - 1);
+        }
+        atomic_store_explicit(&header->magic, SHM_POOL_MAGIC, memory_order_release);
+    } else {
+        // The acquire pairs with the creator's release, so the rest of the
+        // header is complete once the magic is seen. The header still comes
+        // from another process: it must describe exactly this object.
+        int valid = atomic_load_explicit(&header->magic, memory_order_acquire) == SHM_POOL_MAGIC;
+        blocks = valid ? header->block_count : 0;
+        if (!valid || header->mapping_size != total || blocks <= 0 ||
+            (size_t)blocks > total / BLOCK_SIZE ||
+            shm_layout(blocks, &owner_off, &runs_off, &data_off) != total ||
+            header->data_offset != data_off) {
+            POOL_LOG("Error: %s is not a valid shared pool\n", name);
+            munmap(base, total);
+            return NULL;
+        }
+    }
+
+    ShmPool* pool = calloc(1, sizeof(ShmPool));
+    pool->header = header;
+    pool->free_map = (_Atomic uint64_t*)(base + round_up(sizeof(ShmPoolHeader), 64));
+    pool->owner_pid = (_Atomic int32_t*)(base + owner_off);
+    pool->run_blocks = (_Atomic int32_t*)(base + runs_off);
+    pool->data = base + data_off;
+    pool->block_count = blocks;
+    return pool;
+}
+
+void shm_pool_close(ShmPool* pool) {
+    if (!pool) return;
+    munmap(pool->header, pool->header->mapping_size);
+    free(pool);
+}
+
+// Marks blocks [start, start + count) free again.
+static void shm_unclaim(ShmPool* pool, int start, int count) {
+    while (count > 0) {
+        int bit = start % 64;
+        int n = (64 - bit < count) ? 64 - bit : count;
+        uint64_t mask = (n == 64) ? ~0ULL : (((1ULL << n) - 1) << bit);
+        atomic_fetch_or(&pool->free_map[start / 64], mask);
+        start += n;
+        count -= n;
+    }
+}
+
+// Claims blocks [start, start + count) word by word. If another process
+// took any of them first, the words already claimed are given back.
+static int shm_claim(ShmPool* pool, int start, int count) {
+    int pos = start, left = count;
+    while (left > 0) {
+        int bit = pos % 64;
+        int n = (64 - bit < left) ? 64 - bit : left;
+        uint64_t mask = (n == 64) ? ~0ULL : (((1ULL << n) - 1) << bit);
+        _Atomic uint64_t* word = &pool->free_map[pos / 64];
+        uint64_t old = atomic_load(word);
+        do {
+            if ((old & mask) != mask) {
+                shm_unclaim(pool, start, pos - start);
+                return 0;
+            }
+        } while (!atomic_compare_exchange_weak(word, &old, old & ~mask));
+        pos += n;
+        left -= n;
+    }
+    return 1;
+}
+
+// Returns the offset of the new buffer from the pool data, or -1. Offsets
+// are valid in every process attached to the pool.
+long shm_malloc(ShmPool* pool, size_t size) {
+    int needed = (int)((size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    if (needed == 0) needed = 1;
+    // The search reads a racy snapshot of the bitmap; the claim is what
+    // decides, so a lost race only costs another search.
+    for (int attempt = 0; attempt < 64; attempt++) {
+        int hint = atomic_load(&pool->search_hint);
+        int start = bitmap_find_run((const uint64_t*)pool->free_map, pool->block_count, hint, needed);
+        if (start == -1 && hint > 0)
+            start = bitmap_find_run((const uint64_t*)pool->free_map, pool->block_count, 0, needed);
+        if (start == -1) return -1;
+        if (!shm_claim(pool, start, needed)) continue;
+
+        atomic_store(&pool->run_blocks[start], needed);
+        atomic_store(&pool->owner_pid[start], (int32_t)getpid());
+        atomic_store(&pool->search_hint, (start + needed) % pool->block_count);
+        return (long)start * BLOCK_SIZE;
+    }
+    return -1;
+}
+
+void* shm_ptr(ShmPool* pool, long offset) {
+    return offset < 0 ? NULL : pool->data + offset;
+}
+
+// Releases a run. Whoever clears its owner pid first (the owner here or
+// shm_pool_recover) is the one that frees its blocks.
+static int shm_release_run(ShmPool* pool, int start, int32_t owner) {
+    if (!atomic_compare_exchange_strong(&pool->owner_pid[start], &owner, 0)) return 0;
+    int blocks = atomic_exchange(&pool->run_blocks[start], 0);
+    shm_unclaim(pool, start, blocks);
+    return blocks;
+}
+
+void shm_free(ShmPool* pool, long offset) {
+    if (offset < 0 || offset % BLOCK_SIZE != 0 || offset / BLOCK_SIZE >= pool->block_count) {
+        POOL_LOG("Error: Offset %ld is not a shared allocation\n", offset);
+        return;
+    }
+    int start = (int)(offset / BLOCK_SIZE);
+    int32_t owner = atomic_load(&pool->owner_pid[start]);
+    if (owner == 0 || !shm_release_run(pool, start, owner))
+        POOL_LOG("Error: Offset %ld is not a shared allocation\n", offset);
+}
+
+// Gives back every run whose owner process no longer exists. A process that
+// dies between claiming blocks and recording its pid leaks that one run.
+int shm_pool_recover(ShmPool* pool) {
+    int recovered = 0;
+    for (int i = 0; i < pool->block_count; ) {
+        int32_t owner = atomic_load(&pool->owner_pid[i]);
+        if (owner == 0) {
+            i++;
+            continue;
+        }
+        // The run may be released (and its size cleared) at any moment; only
+        // the size returned by a successful release is exact. A stale size
+        // just moves the scan, it never frees blocks.
+        int blocks = atomic_load(&pool->run_blocks[i]);
+        if (kill(owner, 0) == -1 && errno == ESRCH) {
+            int freed = shm_release_run(pool, i, owner);
+            if (freed) POOL_LOG("Recovered %d blocks of dead process %d at block %d\n", freed, owner, i);
+            recovered += freed;
+            if (freed) blocks = freed;
+        }
+        i += blocks > 0 ? blocks : 1;
+    }
+    return recovered;
+}
+
+// Byte-per-block scan used by my_malloc before the bitmap index.
+static int legacy_find_run(const char* owner, int nblocks, int needed) {
     int consecutive_free = 0;
     int start_index = -1;
-
-    for (int i = 0; i < BLOCK_COUNT; i++) {
-        if (block_owner[i] == 0) {
+    for (int i = 0; i < nblocks; i++) {
+        if (owner[i] == 0) {
             if (consecutive_free == 0) start_index = i;
-            consecutive_free++;
-            if (consecutive_free >= blocks_needed) {
-                for (int j = start_index; j < start_index + blocks_needed; j++) {
-                    block_owner[j] = process_id;
-                }
-                
-                void* data_ptr = &memory_pool[start_index * BLOCK_SIZE];
-                ptr_to_block[start_index] = data_ptr;
-                
-                printf("Allocated %zu bytes (%d blocks) for process %c at blocks %d-%d\n",
-                       size, blocks_needed, process_id, start_index, start_index + blocks_needed - 1);
-                return data_ptr;
-            }
+            if (++consecutive_free >= needed) return start_index;
         } else {
             consecutive_free = 0;
         }
     }
+    return -1;
+}
+
+// Benchmarks use pools that cannot grow so failures and fragmentation show.
+static void init_fixed_pool(AllocEngine engine, size_t size) {
+    PoolConfig config = {engine, size, size, 0, HUGE_PAGES_TRANSPARENT};
+    init_memory_config(&config);
+}
+
+// Parses sizes like 4096, 64K, 16M or 1G.
+static size_t parse_size(const char* text) {
+    char* end;
+    double value = strtod(text, &end);
+    switch (*end) {
+        case 'k': case 'K': value *= 1024; break;
+        case 'm': case 'M': value *= 1024 * 1024; break;
+        case 'g': case 'G': value *= 1024.0 * 1024 * 1024; break;
+    }
+    return value > BLOCK_SIZE ? (size_t)value : BLOCK_SIZE;
+}
+
+static long resident_kb() {
+    long pages = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return -1;
+    if (fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = -1;
+    fclose(f);
+    return resident < 0 ? -1 : resident * (getpagesize() / 1024);
+}
+
+// Searches a half-occupied pool with short holes whose only large enough run
+// is placed near the end, so each search has to cross almost the whole pool.
+void benchmark_free_search() {
+    const int needed = 16;
+    printf("Free-run search: %d blocks requested, fragmented pool\n", needed);
+    printf("%10s %12s %14s %14s %9s\n", "pool", "blocks", "byte scan ns", "bitmap ns", "speedup");
+
+    for (long long pool = 4096; pool <= (1LL << 30); pool *= 4) {
+        int nblocks = (int)(pool / BLOCK_SIZE);
+        int nwords = (nblocks + 63) / 64;
+        char* owner = malloc(nblocks);
+        uint64_t* map = calloc(nwords, sizeof(uint64_t));
+        if (!owner || !map) {
+            printf("Error: benchmark allocation failed\n");
+            exit(1);
+        }
+
+        srand(12345);
+        memset(owner, 'x', nblocks);
+        for (int i = 0; i < nblocks; ) {
+            int used = 1 + rand() % 8;
+            int hole = 1 + rand() % (needed - 1);
+            i += used;
+            for (int j = 0; j < hole && i < nblocks; j++, i++) owner[i] = 0;
+        }
+        int tail = nblocks - needed - needed / 2;
+        if (tail < 0) tail = 0;
+        memset(owner + tail, 0, nblocks - tail);
+        for (int i = 0; i < nblocks; i++)
+            if (owner[i] == 0) bitmap_set_range(map, i, 1);
+
+        long long iterations = (1LL << 26) / nblocks;
+        if (iterations < 3) iterations = 3;
+
+        volatile int sink = 0;
+        double t0 = now_ns();
+        for (long long it = 0; it < iterations; it++) sink += legacy_find_run(owner, nblocks, needed);
+        double t1 = now_ns();
+        for (long long it = 0; it < iterations; it++) sink += bitmap_find_run(map, nblocks, 0, needed);
+        double t2 = now_ns();
+
+        if (legacy_find_run(owner, nblocks, needed) != bitmap_find_run(map, nblocks, 0, needed)) {
+            printf("Error: bitmap search disagrees with byte scan at %lld bytes\n", pool);
+            exit(1);
+        }
+
+        double byte_ns = (t1 - t0) / iterations;
+        double bitmap_ns = (t2 - t1) / iterations;
+        if (pool >= (1 << 20))
+            printf("%8lldMB", pool >> 20);
+        else
+            printf("%8lldKB", pool >> 10);
+        printf(" %12d %14.0f %14.0f %8.1fx\n", nblocks, byte_ns, bitmap_ns, byte_ns / bitmap_ns);
+
+        free(owner);
+        free(map);
+    }
+}
+
+typedef enum {
+    TRACE_FREE,
+    TRACE_ALLOC,
+    TRACE_COMPACT
+} TraceKind;
+
+typedef struct {
+    TraceKind kind;
+    int slot;
+    size_t size;
+} TraceOp;
+
+// Mixed workload: mostly small objects, some medium buffers and a few large
+// ones, kept around 60% of the pool. Slots make the trace engine-independent.
+static TraceOp* make_mixed_trace(int op_count, int slot_count, size_t pool_size, unsigned int seed) {
+    TraceOp* trace = malloc(op_count * sizeof(TraceOp));
+    size_t* live = calloc(slot_count, sizeof(size_t));
+    if (!trace || !live) {
+        printf("Error: benchmark allocation failed\n");
+        exit(1);
+    }
+    srand(seed);
+    size_t live_bytes = 0;
+    int live_count = 0;
+    for (int i = 0; i < op_count; i++) {
+        int slot = rand() % slot_count;
+        int want_alloc = live_bytes < pool_size * 6 / 10 && (live_count == 0 || rand() % 2);
+        if (want_alloc) {
+            while (live[slot]) slot = (slot + 1) % slot_count;
+            int kind = rand() % 100;
+            size_t size;
+            if (kind < 70) size = 1 + rand() % 256;
+            else if (kind < 95) size = 256 + rand() % 1792;
+            else size = 2048 + rand() % (pool_size / 16 > 2048 ? pool_size / 16 - 2048 : 1);
+            live[slot] = size;
+            live_bytes += size;
+            live_count++;
+            trace[i] = (TraceOp){TRACE_ALLOC, slot, size};
+        } else {
+            while (!live[slot]) slot = (slot + 1) % slot_count;
+            live_bytes -= live[slot];
+            live[slot] = 0;
+            live_count--;
+            trace[i] = (TraceOp){TRACE_FREE, slot, 0};
+        }
+    }
+    free(live);
+    return trace;
+}
+
+void benchmark_engines(size_t pool_size) {
+    const int op_count = 200000;
+    const int slot_count = (int)(pool_size / BLOCK_SIZE);
+    TraceOp* trace = make_mixed_trace(op_count, slot_count, pool_size, 2024);
+    void** slots = malloc(slot_count * sizeof(void*));
+    size_t* requested = malloc(slot_count * sizeof(size_t));
+    const char* names[] = {"first-fit", "next-fit", "buddy"};
+    AllocEngine engines[] = {ENGINE_CONTIGUOUS, ENGINE_CONTIGUOUS, ENGINE_BUDDY};
+    FitPolicy policies[] = {FIRST_FIT, NEXT_FIT, FIRST_FIT};
+
+    int saved_verbose = pool_verbose;
+    pool_verbose = 0;
+    printf("Engine comparison: %d ops, pool %zu KB (%d blocks)\n", op_count, pool_size / 1024, slot_count);
+    printf("%-10s %8s %9s %12s %12s %12s\n",
+           "engine", "ns/op", "failures", "ext frag avg", "ext frag max", "int frag avg");
+
+    for (int e = 0; e < 3; e++) {
+        double elapsed = 0;
+        int failures = 0;
+        double ext_sum = 0, ext_max = 0, int_sum = 0;
+        int samples = 0;
+
+        // Pass 0 is timed, pass 1 replays the same trace and samples fragmentation.
+        for (int pass = 0; pass < 2; pass++) {
+            init_fixed_pool(engines[e], pool_size);
+            set_fit_policy(policies[e]);
+            memset(slots, 0, slot_count * sizeof(void*));
+            memset(requested, 0, slot_count * sizeof(size_t));
+            size_t live_requested = 0;
+            double t0 = now_ns();
+            for (int i = 0; i < op_count; i++) {
+                TraceOp* op = &trace[i];
+                if (op->kind == TRACE_ALLOC) {
+                    slots[op->slot] = my_malloc(op->size, 'a' + op->slot % 26);
+                    if (!slots[op->slot]) {
+                        if (pass == 0) failures++;
+                    } else {
+                        requested[op->slot] = op->size;
+                        live_requested += op->size;
+                    }
+                } else if (slots[op->slot]) {
+                    my_free(slots[op->slot]);
+                    slots[op->slot] = NULL;
+                    live_requested -= requested[op->slot];
+                }
+                if (pass == 1 && i % 64 == 0) {
+                    int free_blocks = bitmap_count_free(free_map, block_count);
+                    if (free_blocks > 0) {
+                        double ext = 1.0 - (double)bitmap_largest_run(free_map, block_count) / free_blocks;
+                        ext_sum += ext;
+                        if (ext > ext_max) ext_max = ext;
+                    }
+                    size_t reserved = (size_t)(block_count - free_blocks) * BLOCK_SIZE;
+                    if (reserved > 0) int_sum += 1.0 - (double)live_requested / reserved;
+                    samples++;
+                }
+            }
+            if (pass == 0) elapsed = now_ns() - t0;
+            cleanup_memory();
+        }
+
+        printf("%-10s %8.1f %9d %11.1f%% %11.1f%% %11.1f%%\n", names[e], elapsed / op_count, failures,
+               100.0 * ext_sum / samples, 100.0 * ext_max, 100.0 * int_sum / samples);
+    }
 
-    printf("Allocation failed for process %c: not enough contiguous blocks\n", process_id);
+    set_fit_policy(FIRST_FIT);
+    pool_verbose = saved_verbose;
+    free(trace);
+    free(slots);
+    free(requested);
+}
+
+typedef struct {
+    int ops;
+    unsigned int seed;
+    long long allocations;
+    long long failures;
+} StressArgs;
+
+static void* stress_worker(void* arg) {
+    StressArgs* args = arg;
+    void* live[64] = {0};
+    unsigned int seed = args->seed;
+    for (int i = 0; i < args->ops; i++) {
+        int slot = rand_r(&seed) % 64;
+        if (live[slot]) {
+            my_free(live[slot]);
+            live[slot] = NULL;
+        } else {
+            size_t size = (rand_r(&seed) % 10 < 9) ? 1 + rand_r(&seed) % 256 : 256 + rand_r(&seed) % 768;
+            live[slot] = my_malloc(size, 't');
+            if (live[slot]) args->allocations++;
+            else args->failures++;
+        }
+    }
+    for (int slot = 0; slot < 64; slot++) my_free(live[slot]);
     return NULL;
 }
 
-void my_free(void* ptr) {
-    if (!ptr) return;
+// Runs the same per-thread alloc/free loop with thread caches off (every
+// call takes pool_lock) and on, for 1..max_threads threads.
+void benchmark_threads(int max_threads, size_t pool_size) {
+    const int ops = 500000;
+    int saved_verbose = pool_verbose;
+    pool_verbose = 0;
 
-    int start_index = -1;
-    for (int i = 0; i < BLOCK_COUNT; i++) {
-        if (ptr_to_block[i] == ptr) {
-            start_index = i;
-            break;
+    int blocks = (int)(pool_size / BLOCK_SIZE);
+    printf("Thread stress: %d ops per thread, pool %zu KB (%d blocks)\n", ops, pool_size / 1024, blocks);
+    if (blocks < TCACHE_MIN_BLOCKS)
+        printf("Note: thread caches need a pool of at least %d blocks\n", TCACHE_MIN_BLOCKS);
+    printf("%8s %16s %16s %10s %10s\n", "threads", "locked allocs/s", "cached allocs/s", "scaling", "failures");
+
+    double base_rate = 0;
+    for (int threads = 1; threads <= max_threads; threads = (threads * 2 > max_threads && threads < max_threads) ? max_threads : threads * 2) {
+        double rate[2];
+        long long failures = 0;
+        for (int cached = 0; cached < 2; cached++) {
+            set_thread_cache(cached);
+            init_fixed_pool(ENGINE_CONTIGUOUS, pool_size);
+            pthread_t* tids = malloc(threads * sizeof(pthread_t));
+            StressArgs* args = calloc(threads, sizeof(StressArgs));
+            double t0 = now_ns();
+            for (int t = 0; t < threads; t++) {
+                args[t].ops = ops;
+                args[t].seed = 1000 + t;
+                pthread_create(&tids[t], NULL, stress_worker, &args[t]);
+            }
+            long long allocations = 0;
+            for (int t = 0; t < threads; t++) {
+                pthread_join(tids[t], NULL);
+                allocations += args[t].allocations;
+                if (cached) failures += args[t].failures;
+            }
+            rate[cached] = allocations / ((now_ns() - t0) / 1e9);
+            cleanup_memory();
+            free(tids);
+            free(args);
         }
+        if (threads == 1) base_rate = rate[1];
+        printf("%8d %16.0f %16.0f %9.2fx %10lld\n", threads, rate[0], rate[1], rate[1] / base_rate, failures);
     }
-    
-    if (start_index == -1) {
-        printf("Error: Pointer not found\n");
-        return;
+
+    set_thread_cache(1);
+    pool_verbose = saved_verbose;
+}
+
+// Fills the pool with handle allocations and frees about half of them.
+static void make_fragmented_handles(MemHandle* handles, int count) {
+    srand(7);
+    for (int i = 0; i < count; i++) {
+        size_t size = (1 + rand() % 8) * BLOCK_SIZE;
+        handles[i] = my_halloc(size, 'h');
+        if (handles[i]) memset(handle_deref(handles[i]), i, size);
+    }
+    for (int i = 0; i < count; i++) {
+        if (handles[i] && rand() % 2) {
+            my_hfree(handles[i]);
+            handles[i] = 0;
+        }
     }
+}
 
-    char pid = block_owner[start_index];
-    int blocks_freed = 0;
-    
-    for (int i = start_index; i < BLOCK_COUNT && block_owner[i] == pid; i++) {
-        block_owner[i] = 0;
-        ptr_to_block[i] = NULL;
-        blocks_freed++;
+// Compares one stop-the-world compact_memory with compact_step slices of
+// 64 blocks on the same fragmented pool.
+void benchmark_compaction(size_t pool_size) {
+    const int step_blocks = 64;
+    int count = (int)(pool_size / BLOCK_SIZE / 4);
+    MemHandle* handles = malloc(count * sizeof(MemHandle));
+    int saved_verbose = pool_verbose;
+    pool_verbose = 0;
+
+    init_fixed_pool(ENGINE_CONTIGUOUS, pool_size);
+    make_fragmented_handles(handles, count);
+    double t0 = now_ns();
+    compact_memory();
+    double full_ns = now_ns() - t0;
+    int full_run = bitmap_largest_run(free_map, block_count);
+    cleanup_memory();
+
+    init_fixed_pool(ENGINE_CONTIGUOUS, pool_size);
+    make_fragmented_handles(handles, count);
+    int regions = (block_count + COMPACT_REGION_BLOCKS - 1) / COMPACT_REGION_BLOCKS;
+    int idle_steps = 0, steps = 0;
+    double worst_ns = 0, total_ns = 0;
+    while (idle_steps * COMPACT_SCAN_REGIONS < regions) {
+        t0 = now_ns();
+        int moved = compact_step(step_blocks);
+        double ns = now_ns() - t0;
+        total_ns += ns;
+        if (ns > worst_ns) worst_ns = ns;
+        steps++;
+        idle_steps = moved ? 0 : idle_steps + 1;
     }
+    int step_run = bitmap_largest_run(free_map, block_count);
+    int blocks = block_count;
+    cleanup_memory();
 
-    printf("Freed %d blocks of process %c starting at block %d\n", 
-           blocks_freed, pid, start_index);
+    pool_verbose = saved_verbose;
+    printf("Compaction: pool %zu KB (%d blocks), %d regions\n", pool_size / 1024, blocks, regions);
+    printf("full compact_memory: %.0f us pause, largest free run %d blocks\n", full_ns / 1e3, full_run);
+    printf("compact_step(%d):    %d steps, worst pause %.1f us, total %.0f us, largest free run %d blocks\n",
+           step_blocks, steps, worst_ns / 1e3, total_ns / 1e3, step_run);
+    free(handles);
 }
 
-void compact_memory() {
-    printf("\nCompacting memory...\n");
+// Startup cost and resident memory of the mmap arena against the old
+// malloc + memset pool, plus growth and trimming.
+void benchmark_arena(size_t pool_size) {
+    int saved_verbose = pool_verbose;
+    pool_verbose = 0;
+    printf("Arena: %zu MB pool\n", pool_size >> 20);
 
-    int target_index = 0;
-    int moves = 0;
+    long rss0 = resident_kb();
+    double t0 = now_ns();
+    unsigned char* old_pool = malloc(pool_size);
+    if (!old_pool) {
+        printf("Error: benchmark allocation failed\n");
+        exit(1);
+    }
+    // Called through a volatile pointer so the compiler cannot fold it into calloc.
+    void* (*volatile clear)(void*, int, size_t) = memset;
+    clear(old_pool, 0, pool_size);
+    double malloc_ns = now_ns() - t0;
+    long malloc_rss = resident_kb() - rss0;
+    free(old_pool);
 
-    for (int i = 0; i < BLOCK_COUNT; ) {
-        if (block_owner[i] != 0) {
-            char pid = block_owner[i];
-            
-            int block_count = 0;
-            for (int j = i; j < BLOCK_COUNT && block_owner[j] == pid; j++) {
-                block_count++;
+    rss0 = resident_kb();
+    t0 = now_ns();
+    PoolConfig config = {ENGINE_CONTIGUOUS, pool_size, 4 * pool_size, 0, HUGE_PAGES_TRANSPARENT};
+    init_memory_config(&config);
+    double mmap_ns = now_ns() - t0;
+    printf("malloc+memset init: %10.0f us, %8ld KB resident\n", malloc_ns / 1e3, malloc_rss);
+    printf("mmap arena init:    %10.0f us, %8ld KB resident\n", mmap_ns / 1e3, resident_kb() - rss0);
+
+    size_t chunk = 64 * 1024;
+    int count = (int)(2 * pool_size / chunk);
+    void** chunks = malloc(count * sizeof(void*));
+    for (int i = 0; i < count; i++) {
+        chunks[i] = my_malloc(chunk, 'g');
+        if (chunks[i]) memset(chunks[i], 1, chunk);
+    }
+    printf("after filling 2x:   %d blocks committed, %8ld KB resident\n", block_count, resident_kb() - rss0);
+    for (int i = count / 4; i < count; i++) my_free(chunks[i]);
+    size_t trimmed = pool_trim();
+    printf("after freeing 3/4:  %zu KB trimmed,      %8ld KB resident\n", trimmed / 1024, resident_kb() - rss0);
+
+    for (int i = 0; i < count / 4; i++) my_free(chunks[i]);
+    free(chunks);
+    cleanup_memory();
+    pool_verbose = saved_verbose;
+}
+
+typedef enum {
+    PATTERN_UNIFORM,
+    PATTERN_POWER_LAW,
+    PATTERN_PRODUCER_CONSUMER,
+    PATTERN_KINDS
+} TracePattern;
+
+static const char* pattern_names[PATTERN_KINDS] = {"uniform", "power-law", "producer-consumer"};
+
+#define TRACE_COMPACT_EVERY 65536  // synthetic traces compact the pool this often
+
+// Synthetic traces keep the live bytes near 60% of pool_size.
+// Uniform: sizes uniform in 1..4096, random objects are freed.
+// Power-law: each doubling of the size is 60% as likely, random objects are freed.
+// Producer-consumer: bursts of messages are produced and consumed in FIFO order.
+static TraceOp* make_synthetic_trace(TracePattern pattern, int op_count, int slot_count,
+                                     size_t pool_size, unsigned int seed) {
+    TraceOp* trace = malloc(op_count * sizeof(TraceOp));
+    size_t* live = calloc(slot_count, sizeof(size_t));
+    if (!trace || !live) {
+        printf("Error: benchmark allocation failed\n");
+        exit(1);
+    }
+    srand(seed);
+    size_t live_bytes = 0;
+    int live_count = 0;
+    int head = 0, tail = 0;      // producer-consumer FIFO of slots
+    int burst = 0, producing = 1;
+    size_t max_size = pool_size / 16 > 16 ? pool_size / 16 : 16;
+
+    for (int i = 0; i < op_count; i++) {
+        if (i % TRACE_COMPACT_EVERY == TRACE_COMPACT_EVERY - 1) {
+            trace[i] = (TraceOp){TRACE_COMPACT, 0, 0};
+            continue;
+        }
+        int want_alloc;
+        if (pattern == PATTERN_PRODUCER_CONSUMER) {
+            if (burst == 0) {
+                producing = !producing;
+                burst = 1 + rand() % 64;
             }
+            burst--;
+            want_alloc = live_count == 0 || (producing && live_bytes < pool_size * 6 / 10 &&
+                                             live_count < slot_count);
+        } else {
+            want_alloc = live_count == 0 || (live_bytes < pool_size * 6 / 10 && live_count < slot_count &&
+                                             rand() % 2);
+        }
 
-            if (i != target_index) {
-                memmove(&memory_pool[target_index * BLOCK_SIZE],
-                        &memory_pool[i * BLOCK_SIZE],
-                        block_count * BLOCK_SIZE);
-                
-                for (int j = 0; j < block_count; j++) {
-                    block_owner[target_index + j] = pid;
-                    block_owner[i + j] = 0;
-                    ptr_to_block[target_index + j] = &memory_pool[(target_index + j) * BLOCK_SIZE];
-                    ptr_to_block[i + j] = NULL;
-                }
-                
-                moves++;
-                printf("Moved process %c from blocks %d-%d to %d-%d\n", 
-                       pid, i, i + block_count - 1, target_index, target_index + block_count - 1);
+        if (want_alloc) {
+            size_t size;
+            if (pattern == PATTERN_UNIFORM) {
+                size = 1 + rand() % 4096;
+            } else {
+                size_t base = 16;
+                while (base * 2 <= max_size / 2 && rand() % 100 < 60) base *= 2;
+                size = base + rand() % base;
             }
-            
-            target_index += block_count;
-            i += block_count;
+            int slot;
+            if (pattern == PATTERN_PRODUCER_CONSUMER) {
+                slot = head;
+                head = (head + 1) % slot_count;
+            } else {
+                slot = rand() % slot_count;
+                while (live[slot]) slot = (slot + 1) % slot_count;
+            }
+            live[slot] = size;
+            live_bytes += size;
+            live_count++;
+            trace[i] = (TraceOp){TRACE_ALLOC, slot, size};
         } else {
-            i++;
+            int slot;
+            if (pattern == PATTERN_PRODUCER_CONSUMER) {
+                slot = tail;
+                tail = (tail + 1) % slot_count;
+            } else {
+                slot = rand() % slot_count;
+                while (!live[slot]) slot = (slot + 1) % slot_count;
+            }
+            live_bytes -= live[slot];
+            live[slot] = 0;
+            live_count--;
+            trace[i] = (TraceOp){TRACE_FREE, slot, 0};
         }
     }
+    free(live);
+    return trace;
+}
 
-    printf("Compaction complete. Moved %d processes\n", moves);
+// Reads a recorded trace, one operation per line:
+//   a <slot> <size>   allocate size bytes into slot
+//   f <slot>          free the allocation in slot
+//   c                 compact the pool
+// Blank lines and lines starting with # are skipped.
+static TraceOp* load_trace(const char* path, int* op_count, int* slot_count) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        printf("Error: cannot open trace %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    int capacity = 4096, count = 0, max_slot = -1;
+    TraceOp* trace = malloc(capacity * sizeof(TraceOp));
+    char line[128];
+    int line_no = 0;
+    while (trace && fgets(line, sizeof(line), f)) {
+        line_no++;
+        TraceOp op = {TRACE_COMPACT, 0, 0};
+        char kind;
+        long slot = 0;
+        unsigned long long size = 0;
+        if (sscanf(line, " %c", &kind) != 1 || kind == '#') continue;
+        if ((kind == 'a' && sscanf(line, " a %ld %llu", &slot, &size) == 2 && slot >= 0 && size > 0) ||
+            (kind == 'f' && sscanf(line, " f %ld", &slot) == 1 && slot >= 0)) {
+            op = (TraceOp){kind == 'a' ? TRACE_ALLOC : TRACE_FREE, (int)slot, (size_t)size};
+            if (slot > max_slot) max_slot = (int)slot;
+        } else if (kind != 'c') {
+            printf("Error: %s:%d: expected \"a <slot> <size>\", \"f <slot>\" or \"c\"\n", path, line_no);
+            free(trace);
+            fclose(f);
+            return NULL;
+        }
+        if (count == capacity) {
+            capacity *= 2;
+            TraceOp* grown = realloc(trace, capacity * sizeof(TraceOp));
+            if (!grown) free(trace);
+            trace = grown;
+        }
+        if (trace) trace[count++] = op;
+    }
+    fclose(f);
+    if (!trace) {
+        printf("Error: benchmark allocation failed\n");
+        exit(1);
+    }
+    *op_count = count;
+    *slot_count = max_slot + 1 > 0 ? max_slot + 1 : 1;
+    return trace;
 }
 
-void print_memory_map() {
-    printf("\nMemory map:\n");
-    for (int i = 0; i < BLOCK_COUNT; i++) {
-        printf("%c", block_owner[i] ? block_owner[i] : '.');
-        if ((i + 1) % 64 == 0) printf("\n");
+typedef enum {
+    REPLAY_FIRST_FIT,
+    REPLAY_BUDDY,
+    REPLAY_SYSTEM,
+    REPLAY_KINDS
+} ReplayTarget;
+
+static const char* replay_names[REPLAY_KINDS] = {"first-fit", "buddy", "glibc"};
+
+typedef struct {
+    double ns_per_op;
+    double p50_ns;
+    double p99_ns;
+    long peak_rss_kb;
+    double space_overhead;   // average of 1 - live requested bytes / bytes held by the allocator
+    double ext_frag;         // average, -1 when the allocator does not expose it
+    double compact_ms;
+    long failures;
+} ReplayResult;
+
+// Bytes the system allocator holds for live objects, including headers.
+static long system_heap_in_use() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 info = mallinfo2();
+    return (long)(info.uordblks + info.hblkhd);
+#else
+    return -1;
+#endif
+}
+
+typedef struct {
+    uintptr_t address;
+    int slot;
+} SlotAddress;
+
+static int compare_slot_addresses(const void* a, const void* b) {
+    uintptr_t pa = ((const SlotAddress*)a)->address, pb = ((const SlotAddress*)b)->address;
+    return pa < pb ? -1 : pa > pb;
+}
+
+// compact_memory slides runs down without changing their order, so the live
+// slots sorted by address can be matched to the runs again afterwards.
+static void replay_compact(void** slots, int slot_count, SlotAddress* order) {
+    int live = 0;
+    for (int s = 0; s < slot_count; s++)
+        if (slots[s]) order[live++] = (SlotAddress){(uintptr_t)slots[s], s};
+    qsort(order, live, sizeof(SlotAddress), compare_slot_addresses);
+    compact_memory();
+    int k = 0;
+    for (int i = 0; i < block_count && k < live; i++)
+        if (alloc_blocks[i] > 0) slots[order[k++].slot] = &memory_pool[(size_t)i * BLOCK_SIZE];
+}
+
+static int compare_floats(const void* a, const void* b) {
+    float fa = *(const float*)a, fb = *(const float*)b;
+    return fa < fb ? -1 : fa > fb;
+}
+
+// Runs in a child process so peak RSS and heap state start clean. The first
+// pass touches every allocation and measures per-op latency, RSS and
+// fragmentation; the second pass replays the trace again and is timed as a
+// whole without per-op clock reads.
+static ReplayResult replay_trace(ReplayTarget target, const TraceOp* trace, int op_count,
+                                 int slot_count, size_t pool_size) {
+    ReplayResult result = {0};
+    void** slots = calloc(slot_count, sizeof(void*));
+    size_t* requested = calloc(slot_count, sizeof(size_t));
+    SlotAddress* order = malloc(slot_count * sizeof(SlotAddress));
+    float* latency = malloc(op_count * sizeof(float));
+    if (!slots || !requested || !order || !latency) {
+        printf("Error: benchmark allocation failed\n");
+        exit(1);
     }
-    printf("\n");
+    long rss0 = resident_kb();
+    long heap0 = system_heap_in_use();  // the trace and the arrays above
+    double overhead_sum = 0, ext_sum = 0;
+    int samples = 0, timed = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        if (target != REPLAY_SYSTEM) {
+            PoolConfig config = {target == REPLAY_BUDDY ? ENGINE_BUDDY : ENGINE_CONTIGUOUS,
+                                 pool_size, POOL_MAX_SIZE, 0, HUGE_PAGES_OFF};
+            init_memory_config(&config);
+        }
+        size_t live_requested = 0;
+        double start = now_ns();
+        for (int i = 0; i < op_count; i++) {
+            const TraceOp* op = &trace[i];
+            double t0 = pass == 0 ? now_ns() : 0;
+            if (op->kind == TRACE_ALLOC) {
+                if (slots[op->slot]) continue;  // recorded traces may reuse a slot without a free
+                slots[op->slot] = target == REPLAY_SYSTEM ? malloc(op->size)
+                                                          : my_malloc(op->size, 'a' + op->slot % 26);
+            } else if (op->kind == TRACE_FREE) {
+                if (!slots[op->slot]) continue;
+                if (target == REPLAY_SYSTEM) free(slots[op->slot]);
+                else my_free(slots[op->slot]);
+                slots[op->slot] = NULL;
+            } else if (target == REPLAY_SYSTEM) {
+#ifdef __GLIBC__
+                malloc_trim(0);
+#endif
+            } else {
+                replay_compact(slots, slot_count, order);
+            }
+            if (pass == 1) continue;
+
+            double t1 = now_ns();
+            latency[timed++] = (float)(t1 - t0);
+            if (op->kind == TRACE_COMPACT) result.compact_ms += (t1 - t0) / 1e6;
+            if (op->kind == TRACE_ALLOC) {
+                if (slots[op->slot]) {
+                    memset(slots[op->slot], 1, op->size);
+                    requested[op->slot] = op->size;
+                    live_requested += op->size;
+                } else {
+                    result.failures++;
+                }
+            } else if (op->kind == TRACE_FREE) {
+                live_requested -= requested[op->slot];
+            }
+
+            if (i % 256 == 0) {
+                long rss = resident_kb() - rss0;
+                if (rss > result.peak_rss_kb) result.peak_rss_kb = rss;
+                long held;
+                if (target == REPLAY_SYSTEM) {
+                    held = system_heap_in_use() - heap0;
+                } else {
+                    PoolStats st = pool_get_stats();
+                    held = (long)st.bytes_in_use;
+                    ext_sum += st.external_fragmentation;
+                }
+                if (held > 0) {
+                    overhead_sum += 1.0 - (double)live_requested / held;
+                    samples++;
+                }
+            }
+        }
+        if (pass == 1) result.ns_per_op = (now_ns() - start) / op_count;
+
+        for (int s = 0; s < slot_count; s++) {
+            if (!slots[s]) continue;
+            if (target == REPLAY_SYSTEM) free(slots[s]);
+            else my_free(slots[s]);
+            slots[s] = NULL;
+        }
+        if (target != REPLAY_SYSTEM) cleanup_memory();
+    }
+
+    qsort(latency, timed, sizeof(float), compare_floats);
+    result.p50_ns = timed ? latency[timed / 2] : 0;
+    result.p99_ns = timed ? latency[(int)(timed * 0.99)] : 0;
+    result.space_overhead = samples ? overhead_sum / samples : -1;
+    result.ext_frag = target == REPLAY_SYSTEM || samples == 0 ? -1 : ext_sum / samples;
+    free(slots);
+    free(requested);
+    free(order);
+    free(latency);
+    return result;
 }
 
-void find_process_blocks(char pid) {
-    printf("Process %c occupies blocks: ", pid);
-    for (int i = 0; i < BLOCK_COUNT; i++) {
-        if (block_owner[i] == pid) {
-            int start = i;
-            while (i < BLOCK_COUNT && block_owner[i] == pid) i++;
-            printf("%d-%d ", start, i-1);
+static void print_replay_row(ReplayTarget target, const ReplayResult* r) {
+    printf("%-10s %8.1f %8.0f %8.0f %10ld %9.1f%%", replay_names[target], r->ns_per_op, r->p50_ns,
+           r->p99_ns, r->peak_rss_kb, 100.0 * r->space_overhead);
+    if (r->ext_frag >= 0) printf(" %9.1f%%", 100.0 * r->ext_frag);
+    else printf(" %10s", "-");
+    printf(" %10.2f %9ld\n", r->compact_ms, r->failures);
+}
+
+static void replay_compare(const char* name, const TraceOp* trace, int op_count, int slot_count,
+                           size_t pool_size) {
+    printf("\nTrace %s: %d ops, %d slots, pool %zu KB\n", name, op_count, slot_count, pool_size / 1024);
+    printf("%-10s %8s %8s %8s %10s %10s %10s %10s %9s\n", "allocator", "ns/op", "p50 ns", "p99 ns",
+           "peak RSS K", "overhead", "ext frag", "compact ms", "failures");
+    fflush(stdout);
+
+    for (int target = 0; target < REPLAY_KINDS; target++) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            printf("Error: pipe failed: %s\n", strerror(errno));
+            return;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            ReplayResult r = replay_trace(target, trace, op_count, slot_count, pool_size);
+            ssize_t written = write(fds[1], &r, sizeof(r));
+            _exit(written == (ssize_t)sizeof(r) ? 0 : 1);
+        }
+        close(fds[1]);
+        ReplayResult r;
+        ssize_t got = pid > 0 ? read(fds[0], &r, sizeof(r)) : -1;
+        close(fds[0]);
+        if (pid > 0) waitpid(pid, NULL, 0);
+        if (got != (ssize_t)sizeof(r)) {
+            printf("%-10s replay failed\n", replay_names[target]);
+            continue;
         }
+        print_replay_row(target, &r);
     }
-    printf("\n");
 }
 
-int main() {
-    init_memory();
+// Replays synthetic traces, or a recorded one when `source` names a file,
+// through both pool engines and the system malloc.
+void benchmark_replay(const char* source, size_t pool_size, int op_count) {
+    int saved_verbose = pool_verbose;
+    pool_verbose = 0;
+    printf("Trace replay, latency is per op including one clock read\n");
+
+    int pattern = -1;
+    for (int p = 0; p < PATTERN_KINDS; p++)
+        if (strcmp(source, pattern_names[p]) == 0) pattern = p;
+
+    if (pattern == -1 && strcmp(source, "all") != 0) {
+        int slot_count;
+        TraceOp* trace = load_trace(source, &op_count, &slot_count);
+        if (trace) {
+            replay_compare(source, trace, op_count, slot_count, pool_size);
+            free(trace);
+        }
+    } else {
+        int slot_count = (int)(pool_size / BLOCK_SIZE);
+        for (int p = 0; p < PATTERN_KINDS; p++) {
+            if (pattern != -1 && p != pattern) continue;
+            TraceOp* trace = make_synthetic_trace(p, op_count, slot_count, pool_size, 2024 + p);
+            replay_compare(pattern_names[p], trace, op_count, slot_count, pool_size);
+            free(trace);
+        }
+    }
+    pool_verbose = saved_verbose;
+}
+
+static int shm_stress_child(const char* name, int ops, unsigned int seed) {
+    ShmPool* pool = shm_pool_open(name, 0, 0);
+    if (!pool) return 1;
+    int32_t me = (int32_t)getpid();
+    long live[32];
+    for (int i = 0; i < 32; i++) live[i] = -1;
+    int corrupted = 0;
+    for (int i = 0; i < ops; i++) {
+        int slot = rand_r(&seed) % 32;
+        if (live[slot] >= 0) {
+            int32_t* data = shm_ptr(pool, live[slot]);
+            if (data[0] != me) corrupted++;
+            shm_free(pool, live[slot]);
+            live[slot] = -1;
+        } else {
+            live[slot] = shm_malloc(pool, 1 + rand_r(&seed) % 2048);
+            if (live[slot] >= 0) ((int32_t*)shm_ptr(pool, live[slot]))[0] = me;
+        }
+    }
+    for (int i = 0; i < 32; i++) if (live[i] >= 0) shm_free(pool, live[i]);
+    shm_pool_close(pool);
+    return corrupted ? 2 : 0;
+}
+
+// Several real processes allocate from one shared pool at once; one passes
+// a buffer to the parent by offset, and one exits without freeing its
+// buffers so the parent can recover them.
+void shm_demo(int processes) {
+    char name[64];
+    snprintf(name, sizeof(name), "/os7_pool_%d", (int)getpid());
+    const size_t size = 4 * 1024 * 1024;
+    const int ops = 200000;
+
+    ShmPool* pool = shm_pool_open(name, size, 1);
+    if (!pool) exit(1);
+    printf("Shared pool %s: %d blocks of %d bytes\n", name, pool->block_count, BLOCK_SIZE);
+
+    double t0 = now_ns();
+    for (int p = 0; p < processes; p++) {
+        if (fork() == 0) _exit(shm_stress_child(name, ops, 100 + p));
+    }
+    int failed = 0;
+    for (int p = 0; p < processes; p++) {
+        int status;
+        wait(&status);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed++;
+    }
+    double elapsed = now_ns() - t0;
+    printf("%d processes x %d ops: %.0f ops/s, %d processes saw foreign data\n",
+           processes, ops, processes * ops / (elapsed / 1e9), failed);
+
+    int pipefd[2];
+    if (pipe(pipefd) != 0) exit(1);
+    if (fork() == 0) {
+        ShmPool* child = shm_pool_open(name, 0, 0);
+        long offset = shm_malloc(child, 1024 * 1024);
+        snprintf(shm_ptr(child, offset), 64, "1 MB written by process %d", (int)getpid());
+        if (write(pipefd[1], &offset, sizeof(offset)) != sizeof(offset)) _exit(1);
+        _exit(0);
+    }
+    long offset = -1;
+    if (read(pipefd[0], &offset, sizeof(offset)) == sizeof(offset) && offset >= 0) {
+        printf("Received offset %ld through the pipe: \"%s\"\n", offset, (char*)shm_ptr(pool, offset));
+        shm_free(pool, offset);
+    }
+    wait(NULL);
+    close(pipefd[0]);
+    close(pipefd[1]);
+
+    pid_t crashed = fork();
+    if (crashed == 0) {
+        ShmPool* child = shm_pool_open(name, 0, 0);
+        for (int i = 0; i < 3; i++) shm_malloc(child, 10000);
+        _exit(0);
+    }
+    waitpid(crashed, NULL, 0);
+    int recovered = shm_pool_recover(pool);
+    printf("Process %d exited holding buffers: recovered %d blocks\n", (int)crashed, recovered);
+
+    int free_blocks = bitmap_count_free((const uint64_t*)pool->free_map, pool->block_count);
+    printf("Free blocks after all processes: %d of %d\n", free_blocks, pool->block_count);
+    shm_pool_close(pool);
+    shm_unlink(name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "bench-search") == 0) {
+        benchmark_free_search();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "bench-engines") == 0) {
+        benchmark_engines(argc > 2 ? parse_size(argv[2]) : BENCH_POOL_SIZE);
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "bench-threads") == 0) {
+        int max_threads = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        benchmark_threads(max_threads > 0 ? max_threads : 1, argc > 3 ? parse_size(argv[3]) : BENCH_POOL_SIZE);
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "bench-compact") == 0) {
+        benchmark_compaction(argc > 2 ? parse_size(argv[2]) : BENCH_POOL_SIZE);
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "bench-replay") == 0) {
+        benchmark_replay(argc > 2 ? argv[2] : "all", argc > 3 ? parse_size(argv[3]) : BENCH_POOL_SIZE,
+                         argc > 4 ? atoi(argv[4]) : 500000);
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "bench-arena") == 0) {
+        benchmark_arena(argc > 2 ? parse_size(argv[2]) : 256 * 1024 * 1024);
+        return 0;
+    }
+
+    pool_verbose = 1;
+    if (argc > 1 && strcmp(argv[1], "shm") == 0) {
+        shm_demo(argc > 2 ? atoi(argv[2]) : 4);
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "buddy") == 0)
+        init_memory_engine(ENGINE_BUDDY);
+    else
+        init_memory();
 
     printf("=== Initial allocation ===\n");
     void* proc1 = my_malloc(200, '1');
@@ -170,6 +2482,10 @@ int main() {
     void* proc4 = my_malloc(128, '4');
     print_memory_map();
 
+    printf("\n=== Growing process 4 in place ===\n");
+    proc4 = my_realloc(proc4, 256);
+    print_memory_map();
+
     printf("\n=== Before compaction ===\n");
     find_process_blocks('1');
     find_process_blocks('3');
@@ -183,6 +2499,26 @@ int main() {
     find_process_blocks('3');
     find_process_blocks('4');
 
+    printf("\n=== Relocatable handles ===\n");
+    MemHandle h5 = my_halloc(200, '5');
+    MemHandle h6 = my_halloc(100, '6');
+    MemHandle h7 = my_halloc(300, '7');
+    strcpy(handle_pin(h7), "process 7 data");
+    my_hfree(h6);
+    print_memory_map();
+    compact_step(block_count);
+    handle_unpin(h7);
+    compact_step(block_count);
+    print_memory_map();
+    printf("Handle %d now at block %d: \"%s\"\n", h7,
+           (int)(((unsigned char*)handle_deref(h7) - memory_pool) / BLOCK_SIZE), (char*)handle_deref(h7));
+    my_hfree(h5);
+    my_hfree(h7);
+
+    printf("\n=== Statistics ===\n");
+    print_pool_stats();
+    dump_memory_map(stdout);
+
     cleanup_memory();
     return 0;
 }
\ No newline at end of file
@@ -2,7 +2,12 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <strings.h>
+#include <stdint.h>
 #include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/resource.h>
 
 #define CYLINDERS 500
 #define HEADS 4
@@ -28,6 +33,24 @@ typedef struct {
     double completion_time; // Время завершения обслуживания
 } DiskRequest;
 
+// Оперативная статистика времени отклика: среднее и дисперсия по Уэлфорду
+// и лог-линейная HDR-гистограмма. Значения хранятся в микросекундах: до
+// 2^LATENCY_SUB_BITS мкс корзины точные, дальше каждая октава делится на
+// LATENCY_HALF корзин, так что относительная погрешность не больше 1/64.
+#define LATENCY_UNIT 1000.0     // единиц гистограммы в мс
+#define LATENCY_SUB_BITS 7
+#define LATENCY_HALF (1 << (LATENCY_SUB_BITS - 1))
+#define LATENCY_MAX_BITS 40     // больше 2^40 мкс (около 12 суток) не различаются
+#define LATENCY_BUCKETS ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 2) * LATENCY_HALF)
+
+typedef struct {
+    long long count;
+    double mean;
+    double m2;              // сумма квадратов отклонений от среднего
+    double min;
+    double max;
+    uint64_t buckets[LATENCY_BUCKETS];
+} LatencyStats;
 
 typedef struct {
     double min_time;
@@ -37,6 +60,14 @@ typedef struct {
     int max_queue_length;
     double total_idle_time;
     int total_requests;
+    double p50_time;
+    double p90_time;
+    double p99_time;
+    double p999_time;
+    double throughput;      // запросов в секунду
+    int merged_requests;    // пристроены к соседней операции в очереди
+    int cache_hits;         // операции дисков, обслуженные кэшем
+    LatencyStats latency;
 } SimulationStats;
 
 typedef struct {
@@ -45,229 +76,1335 @@ typedef struct {
     int count;
 } HistogramBin;
 
+static int latency_bucket(uint64_t value) {
+    if (value < (1ULL << LATENCY_SUB_BITS)) return (int)value;
+    if (value >= (1ULL << LATENCY_MAX_BITS)) value = (1ULL << LATENCY_MAX_BITS) - 1;
+    int shift = 63 - __builtin_clzll(value) - (LATENCY_SUB_BITS - 1);
+    return shift * LATENCY_HALF + (int)(value >> shift);
+}
+
+// Границы корзины в мс
+static void latency_bucket_range(int bucket, double* low, double* high) {
+    int shift = bucket < (1 << LATENCY_SUB_BITS) ? 0 : bucket / LATENCY_HALF - 1;
+    uint64_t first = (uint64_t)(bucket - shift * LATENCY_HALF) << shift;
+    *low = first / LATENCY_UNIT;
+    *high = (first + (1ULL << shift)) / LATENCY_UNIT;
+}
+
+void latency_reset(LatencyStats* s) {
+    memset(s, 0, sizeof(*s));
+}
+
+void latency_record(LatencyStats* s, double ms) {
+    s->count++;
+    double delta = ms - s->mean;
+    s->mean += delta / s->count;
+    s->m2 += delta * (ms - s->mean);
+    if (s->count == 1 || ms < s->min) s->min = ms;
+    if (s->count == 1 || ms > s->max) s->max = ms;
+    s->buckets[latency_bucket((uint64_t)(ms * LATENCY_UNIT))]++;
+}
+
+double latency_std_dev(const LatencyStats* s) {
+    return s->count ? sqrt(s->m2 / s->count) : 0;
+}
+
+// Время отклика, которое не превышают fraction всех запросов, с точностью
+// до корзины
+double latency_percentile(const LatencyStats* s, double fraction) {
+    if (s->count == 0) return 0;
+    long long rank = (long long)ceil(fraction * s->count);
+    if (rank < 1) rank = 1;
+    long long seen = 0;
+    int bucket = 0;
+    while ((seen += s->buckets[bucket]) < rank) bucket++;
+    double low, high;
+    latency_bucket_range(bucket, &low, &high);
+    return fmin(fmax((low + high) / 2, s->min), s->max);
+}
+
+double calculate_travel_time(int cylinders) {
+    return cylinders * SEEK_TIME_PER_CYLINDER;
+}
+
 double calculate_seek_time(int current_cylinder, int target_cylinder) {
-    return fabs(current_cylinder - target_cylinder) * SEEK_TIME_PER_CYLINDER;
+    return calculate_travel_time(abs(current_cylinder - target_cylinder));
 }
 
 double calculate_rotational_latency(double current_angle, int target_sector) {
     double target_angle = target_sector * (360.0 / SECTORS_PER_TRACK);
-    double angle_diff = fmod(target_angle - current_angle + 360.0, 360.0);
+    // Оба угла в [0, 360), так что вместо fmod хватает одного точного вычитания
+    double angle_diff = target_angle - current_angle + 360.0;
+    if (angle_diff >= 360.0) angle_diff -= 360.0;
     return (angle_diff / 360.0) * ROTATION_TIME;
 }
 
+// Угол головки после поворота на delta градусов; длинные передачи из трасс
+// проворачивают диск много раз, и для них остаётся fmod
+double advance_angle(double angle, double delta) {
+    angle += delta;
+    if (angle < 360.0) return angle;
+    return angle < 720.0 ? angle - 360.0 : fmod(angle, 360.0);
+}
+
 double calculate_transfer_time(int num_sectors, int operation) {
     double base_time = num_sectors * SECTOR_TIME;
     return (operation == 1) ? base_time * 2 : base_time;
 }
 
 
-DiskRequest* generate_requests(double t_max, int n, int* total_requests) {
+// Счётный генератор (SplitMix64): i-е число — хеш ключа и номера i. Поток
+// задаётся только ключом, поэтому прогоны воспроизводимы и не зависят от
+// того, сколько потоков и в каком порядке их выполняют.
+typedef struct {
+    uint64_t key;
+    uint64_t counter;
+} Rng;
+
+static uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static Rng rng_make(uint64_t seed, uint64_t stream) {
+    Rng rng = {mix64(seed ^ mix64(stream)), 0};
+    return rng;
+}
+
+static uint64_t rng_next(Rng* rng) {
+    return mix64(rng->key + ++rng->counter * 0x9e3779b97f4a7c15ULL);
+}
+
+// Равномерно на [0, 1)
+static double rng_uniform(Rng* rng) {
+    return (rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Равномерно на [0, n)
+static int rng_below(Rng* rng, int n) {
+    return (int)(((rng_next(rng) >> 32) * (uint64_t)n) >> 32);
+}
+
+// Поток запросов определяется seed, t_max и n
+// Случайный запрос к равномерно выбранному месту диска размером 1..n секторов
+static void random_request(Rng* rng, int n, double arrival_time, DiskRequest* out) {
+    out->arrival_time = arrival_time;
+    out->cylinder = rng_below(rng, CYLINDERS);
+    out->head = rng_below(rng, HEADS);
+    out->sector = rng_below(rng, SECTORS_PER_TRACK);
+    out->operation = rng_below(rng, 2);
+    out->num_sectors = rng_below(rng, n) + 1;
+    out->start_time = 0;
+    out->completion_time = 0;
+}
+
+DiskRequest* generate_requests(double t_max, int n, uint64_t seed, int* total_requests) {
     int max_requests = (int)(SIMULATION_TIME / (t_max * 1000)) * 2;
     DiskRequest* requests = malloc(max_requests * sizeof(DiskRequest));
 
     double current_time = 0;
     int count = 0;
-    srand(time(NULL) + (int)(t_max * 1000));
+    uint64_t t_max_bits;
+    memcpy(&t_max_bits, &t_max, sizeof(t_max_bits));
+    Rng rng = rng_make(seed, mix64(t_max_bits) ^ (uint64_t)n);
 
     while (current_time < SIMULATION_TIME && count < max_requests) {
-        double interval = ((double)rand() / RAND_MAX) * t_max * 1000;
+        double interval = rng_uniform(&rng) * t_max * 1000;
         current_time += interval;
         if (current_time >= SIMULATION_TIME) break;
 
-        requests[count].arrival_time = current_time;
-        requests[count].cylinder = rand() % CYLINDERS;
-        requests[count].head = rand() % HEADS;
-        requests[count].sector = rand() % SECTORS_PER_TRACK;
-        requests[count].operation = rand() % 2;
-        requests[count].num_sectors = (rand() % n) + 1;
-        requests[count].start_time = 0;
-        requests[count].completion_time = 0;
-        count++;
+        random_request(&rng, n, current_time, &requests[count++]);
     }
 
     *total_requests = count;
     return requests;
 }
 
+// Положение головки, которое видит планировщик при выборе запроса
+typedef struct {
+    double time;     // текущее время, мс
+    int cylinder;
+    double angle;    // угол поворота диска, градусы
+} HeadState;
+
+// Планировщик хранит очередь ожидания и выбирает следующий запрос.
+// Номера запросов растут в порядке поступления, а сами запросы лежат в
+// кольце: номер i хранится в requests[i & (capacity - 1)], capacity —
+// степень двойки. pick_next возвращает номер запроса и путь головки в цилиндрах до него
+// (для SCAN и C-SCAN он включает проход до края диска). update, если
+// задан, вызывается после того, как у ждущего запроса сменился начальный
+// сектор (цилиндр и время прихода не меняются).
+typedef struct {
+    const char* name;
+    int variant;
+    void* (*create)(const DiskRequest* requests, int capacity, int variant);
+    void (*enqueue)(void* queue, int index);
+    int (*pick_next)(void* queue, const HeadState* head, int* travel);
+    void (*destroy)(void* queue);
+    void (*update)(void* queue, int index);
+} Scheduler;
+
 // --- FIFO ---
-void simulate_fifo(DiskRequest* requests, int total_requests, SimulationStats* stats) {
-    double current_time = 0;
-    int current_cylinder = 0;
-    double current_angle = 0;
-    int queue_length = 0;
-    int max_queue_length = 0;
-    double total_idle_time = 0;
+// Запросы поступают по возрастанию индекса, поэтому очередь — это курсор.
+typedef struct {
+    const DiskRequest* requests;
+    int mask;
+    int next;
+} FifoQueue;
+
+static void* fifo_create(const DiskRequest* requests, int capacity, int variant) {
+    FifoQueue* q = calloc(1, sizeof(FifoQueue));
+    q->requests = requests;
+    q->mask = capacity - 1;
+    return q;
+}
+
+static void fifo_enqueue(void* queue, int index) {
+}
+
+static int fifo_pick_next(void* queue, const HeadState* head, int* travel) {
+    FifoQueue* q = queue;
+    int index = q->next++;
+    *travel = abs(head->cylinder - q->requests[index & q->mask].cylinder);
+    return index;
+}
+
+// --- Очередь по цилиндрам ---
+// У каждого цилиндра свой FIFO-список запросов, непустые цилиндры отмечены
+// в битовой карте, поэтому ближайший цилиндр в любую сторону ищется за
+// O(CYLINDERS / 64). Запрос стоит не более чем в одной очереди, так что
+// несколько очередей могут делить один массив next.
+#define CYLINDER_WORDS ((CYLINDERS + 63) / 64)
+
+typedef struct {
+    int head[CYLINDERS];
+    int tail[CYLINDERS];
+    uint64_t map[CYLINDER_WORDS];
+    int* next;                // следующий номер в списке, по номеру & mask
+    int mask;
+    int count;
+} CylinderQueue;
+
+static void cylinder_queue_init(CylinderQueue* q, int* next, int mask) {
+    for (int c = 0; c < CYLINDERS; c++) q->head[c] = q->tail[c] = -1;
+    memset(q->map, 0, sizeof(q->map));
+    q->next = next;
+    q->mask = mask;
+    q->count = 0;
+}
+
+// Следующий номер после index в списке цилиндра, или -1
+static int cylinder_queue_next(const CylinderQueue* q, int index) {
+    return q->next[index & q->mask];
+}
+
+static void cylinder_queue_push(CylinderQueue* q, int cylinder, int index) {
+    q->next[index & q->mask] = -1;
+    if (q->tail[cylinder] == -1) {
+        q->head[cylinder] = index;
+        q->map[cylinder / 64] |= 1ULL << (cylinder % 64);
+    } else {
+        q->next[q->tail[cylinder] & q->mask] = index;
+    }
+    q->tail[cylinder] = index;
+    q->count++;
+}
+
+static int cylinder_queue_pop(CylinderQueue* q, int cylinder) {
+    int index = q->head[cylinder];
+    q->head[cylinder] = cylinder_queue_next(q, index);
+    if (q->head[cylinder] == -1) {
+        q->tail[cylinder] = -1;
+        q->map[cylinder / 64] &= ~(1ULL << (cylinder % 64));
+    }
+    q->count--;
+    return index;
+}
+
+// Ближайший непустой цилиндр не выше cylinder, или -1
+static int cylinder_below(const uint64_t* map, int cylinder) {
+    int word = cylinder / 64;
+    uint64_t bits = map[word] & (~0ULL >> (63 - cylinder % 64));
+    while (!bits) {
+        if (--word < 0) return -1;
+        bits = map[word];
+    }
+    return word * 64 + 63 - __builtin_clzll(bits);
+}
+
+// Ближайший непустой цилиндр не ниже cylinder, или -1
+static int cylinder_above(const uint64_t* map, int cylinder) {
+    int word = cylinder / 64;
+    uint64_t bits = map[word] & (~0ULL << (cylinder % 64));
+    while (!bits) {
+        if (++word >= CYLINDER_WORDS) return -1;
+        bits = map[word];
+    }
+    return word * 64 + __builtin_ctzll(bits);
+}
+
+// --- SSTF ---
+typedef struct {
+    const DiskRequest* requests;
+    CylinderQueue pending;
+} SstfQueue;
+
+static void* sstf_create(const DiskRequest* requests, int capacity, int variant) {
+    SstfQueue* q = malloc(sizeof(SstfQueue));
+    q->requests = requests;
+    cylinder_queue_init(&q->pending, malloc(capacity * sizeof(int)), capacity - 1);
+    return q;
+}
+
+static void sstf_enqueue(void* queue, int index) {
+    SstfQueue* q = queue;
+    cylinder_queue_push(&q->pending, q->requests[index & q->pending.mask].cylinder, index);
+}
+
+static int sstf_pick_next(void* queue, const HeadState* head, int* travel) {
+    SstfQueue* q = queue;
+    int current = head->cylinder;
+    int below = cylinder_below(q->pending.map, current);
+    int above = cylinder_above(q->pending.map, current);
+
+    // При равном расстоянии выбирается запрос, поступивший раньше
+    int cylinder;
+    if (below == -1) cylinder = above;
+    else if (above == -1) cylinder = below;
+    else if (current - below != above - current)
+        cylinder = (current - below < above - current) ? below : above;
+    else
+        cylinder = (q->pending.head[below] < q->pending.head[above]) ? below : above;
+
+    *travel = abs(current - cylinder);
+    return cylinder_queue_pop(&q->pending, cylinder);
+}
+
+static void sstf_destroy(void* queue) {
+    SstfQueue* q = queue;
+    free(q->pending.next);
+    free(q);
+}
+
+// --- SATF ---
+// Shortest Access Time First: выбирается запрос с наименьшим временем
+// позиционирования (поиск + ожидание сектора) в той же модели, по которой
+// движок считает обслуживание. Ожидание сектора входит с весом
+// SATF_ROTATION_WEIGHT: с полным весом жадный выбор уводит головку на
+// десяток цилиндров ради доли оборота, и у насыщения среднее время отклика
+// выходит хуже, чем у SSTF.
+//
+// Против голодания запрос, прождавший дольше SATF_DEADLINE, получает бонус
+// SATF_OVERDUE_CREDIT = полный поиск + оборот. Его оценка тогда
+// отрицательна, и он обслуживается раньше всех непросроченных; просроченные
+// между собой выбираются по позиционированию. Бонус не растёт со временем,
+// поэтому под перегрузкой SATF не вырождается в FIFO.
+//
+// Ожидание сектора неотрицательно, а бонус не больше, чем у самого старого
+// запроса, поэтому цилиндры перебираются от текущего наружу, пока время
+// поиска за вычетом этого бонуса не превысит лучший вариант.
+//
+// Ждущие запросы цилиндра лежат по столбцам в порядке прихода: номер, время
+// прихода и сектор. Ядро satf_score оценивает весь цилиндр сразу по
+// SATF_LANES запросов векторными операциями GCC и без fmod; результат
+// совпадает с satf_cost до бита.
+#define SATF_ROTATION_WEIGHT 0.5
+#define SATF_DEADLINE 5000.0  // мс
+#define SATF_OVERDUE_CREDIT ((CYLINDERS - 1) * SEEK_TIME_PER_CYLINDER + ROTATION_TIME)
+#define SATF_LANES 4
+
+_Static_assert(SECTORS_PER_TRACK <= 256, "сектор хранится в uint8_t");
+
+typedef struct {
+    int* index;
+    double* arrival;
+    uint8_t* sector;
+    int count;
+    int capacity;             // кратна SATF_LANES
+} SatfBucket;
+
+typedef struct {
+    const DiskRequest* requests;
+    SatfBucket buckets[CYLINDERS];
+    uint64_t map[CYLINDER_WORDS];
+    double* cost;             // оценки одного цилиндра
+    int cost_capacity;
+    unsigned char* served;
+    int mask;
+    int oldest;               // все запросы с меньшим индексом уже обслужены
+} SatfQueue;
+
+static void* satf_create(const DiskRequest* requests, int capacity, int variant) {
+    SatfQueue* q = calloc(1, sizeof(SatfQueue));
+    q->requests = requests;
+    q->served = calloc(capacity, 1);
+    q->mask = capacity - 1;
+    return q;
+}
+
+static void satf_enqueue(void* queue, int index) {
+    SatfQueue* q = queue;
+    const DiskRequest* req = &q->requests[index & q->mask];
+    SatfBucket* b = &q->buckets[req->cylinder];
+    if (b->count == b->capacity) {
+        b->capacity = b->capacity ? b->capacity * 2 : SATF_LANES;
+        b->index = realloc(b->index, b->capacity * sizeof(int));
+        b->arrival = realloc(b->arrival, b->capacity * sizeof(double));
+        b->sector = realloc(b->sector, b->capacity);
+        if (b->capacity > q->cost_capacity) {
+            q->cost_capacity = b->capacity;
+            q->cost = realloc(q->cost, q->cost_capacity * sizeof(double));
+        }
+    }
+    b->index[b->count] = index;
+    b->arrival[b->count] = req->arrival_time;
+    b->sector[b->count] = (uint8_t)req->sector;
+    b->count++;
+    q->map[req->cylinder / 64] |= 1ULL << (req->cylinder % 64);
+    q->served[index & q->mask] = 0;
+}
+
+// Номера в цилиндре возрастают, поэтому запрос ищется делением пополам
+static void satf_update(void* queue, int index) {
+    SatfQueue* q = queue;
+    const DiskRequest* req = &q->requests[index & q->mask];
+    SatfBucket* b = &q->buckets[req->cylinder];
+    int low = 0, high = b->count - 1;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (b->index[middle] < index) low = middle + 1;
+        else high = middle;
+    }
+    b->sector[low] = (uint8_t)req->sector;
+}
+
+// Бонус за ожидание с момента arrival
+static double satf_credit(double arrival, double now) {
+    return now - arrival > SATF_DEADLINE ? SATF_OVERDUE_CREDIT : 0.0;
+}
 
-    stats->min_time = 1e9;
-    stats->max_time = 0;
-    double sum_time = 0;
-    double sum_squared_time = 0;
+// Оценка одного запроса; по ней проверяется satf_score
+static double satf_cost(const DiskRequest* req, const HeadState* head) {
+    return calculate_seek_time(head->cylinder, req->cylinder) +
+           SATF_ROTATION_WEIGHT * calculate_rotational_latency(head->angle, req->sector) -
+           satf_credit(req->arrival_time, head->time);
+}
 
-    int request_index = 0;
+// Оценивает count запросов одного цилиндра. Хвост до кратного SATF_LANES
+// считается по мусору в запасе ёмкости и не читается.
+static void satf_score(const double* arrival, const uint8_t* sector, int count, double seek_time,
+                       const HeadState* head, double* cost) {
+#if defined(__GNUC__)
+    typedef double Lanes __attribute__((vector_size(SATF_LANES * sizeof(double))));
+    typedef long long Mask __attribute__((vector_size(SATF_LANES * sizeof(double))));
+    const Lanes full = {360.0, 360.0, 360.0, 360.0};
+    const Lanes deadline = SATF_DEADLINE - (Lanes){};
+    const Lanes overdue = SATF_OVERDUE_CREDIT - (Lanes){};
+    Lanes seek = seek_time - (Lanes){};
+    Lanes angle = head->angle - (Lanes){};
+    Lanes now = head->time - (Lanes){};
+    for (int k = 0; k < count; k += SATF_LANES) {
+        Lanes arrived, target = {sector[k], sector[k + 1], sector[k + 2], sector[k + 3]};
+        memcpy(&arrived, arrival + k, sizeof(arrived));
+        // target - angle + 360 лежит в (0, 720): вычитание 360 точно, как fmod
+        Lanes diff = target * (360.0 / SECTORS_PER_TRACK) - angle + 360.0;
+        diff -= (Lanes)((Mask)full & (diff >= full));
+        Lanes credit = (Lanes)((Mask)overdue & (now - arrived > deadline));
+        Lanes total = seek + SATF_ROTATION_WEIGHT * (diff / 360.0 * ROTATION_TIME) - credit;
+        memcpy(cost + k, &total, sizeof(total));
+    }
+#else
+    for (int k = 0; k < count; k++) {
+        double diff = sector[k] * (360.0 / SECTORS_PER_TRACK) - head->angle + 360.0;
+        if (diff >= 360.0) diff -= 360.0;
+        cost[k] = seek_time + SATF_ROTATION_WEIGHT * (diff / 360.0 * ROTATION_TIME) -
+                  satf_credit(arrival[k], head->time);
+    }
+#endif
+}
 
-    while (request_index < total_requests) {
-        while (request_index < total_requests && requests[request_index].arrival_time <= current_time) {
-            queue_length++;
-            request_index++;
+static int satf_pick_next(void* queue, const HeadState* head, int* travel) {
+    SatfQueue* q = queue;
+    int current = head->cylinder;
+    while (q->served[q->oldest & q->mask]) q->oldest++;
+    double max_credit = satf_credit(q->requests[q->oldest & q->mask].arrival_time, head->time);
+
+    int best = -1, best_cylinder = 0, best_slot = 0;
+    double best_cost = 0;
+    int below = cylinder_below(q->map, current);
+    int above = current + 1 < CYLINDERS ? cylinder_above(q->map, current + 1) : -1;
+    while (below != -1 || above != -1) {
+        int cylinder = (above == -1 || (below != -1 && current - below <= above - current)) ? below : above;
+        double seek_time = calculate_seek_time(current, cylinder);
+        if (best != -1 && seek_time - max_credit > best_cost) break;
+
+        // Цилиндр упорядочен по приходу: самый большой бонус у первого
+        SatfBucket* b = &q->buckets[cylinder];
+        if (best == -1 || seek_time - satf_credit(b->arrival[0], head->time) <= best_cost) {
+            satf_score(b->arrival, b->sector, b->count, seek_time, head, q->cost);
+            for (int k = 0; k < b->count; k++) {
+                if (best == -1 || q->cost[k] < best_cost || (q->cost[k] == best_cost && b->index[k] < best)) {
+                    best = b->index[k];
+                    best_cost = q->cost[k];
+                    best_cylinder = cylinder;
+                    best_slot = k;
+                }
+            }
         }
 
-        if (queue_length > max_queue_length)
-            max_queue_length = queue_length;
+        if (cylinder == below) below = below > 0 ? cylinder_below(q->map, below - 1) : -1;
+        else above = above + 1 < CYLINDERS ? cylinder_above(q->map, above + 1) : -1;
+    }
+
+    SatfBucket* b = &q->buckets[best_cylinder];
+    int rest = b->count - best_slot - 1;
+    memmove(b->index + best_slot, b->index + best_slot + 1, rest * sizeof(int));
+    memmove(b->arrival + best_slot, b->arrival + best_slot + 1, rest * sizeof(double));
+    memmove(b->sector + best_slot, b->sector + best_slot + 1, rest);
+    if (--b->count == 0) q->map[best_cylinder / 64] &= ~(1ULL << (best_cylinder % 64));
+    q->served[best & q->mask] = 1;
+    *travel = abs(current - best_cylinder);
+    return best;
+}
+
+static void satf_destroy(void* queue) {
+    SatfQueue* q = queue;
+    for (int c = 0; c < CYLINDERS; c++) {
+        free(q->buckets[c].index);
+        free(q->buckets[c].arrival);
+        free(q->buckets[c].sector);
+    }
+    free(q->cost);
+    free(q->served);
+    free(q);
+}
 
-        if (queue_length > 0) {
-            DiskRequest* req = &requests[request_index - queue_length];
-            double seek_time = calculate_seek_time(current_cylinder, req->cylinder);
-            double rot_latency = calculate_rotational_latency(current_angle, req->sector);
-            double transfer_time = calculate_transfer_time(req->num_sectors, req->operation);
-            double service_time = seek_time + rot_latency + transfer_time;
+// --- Семейство лифтовых алгоритмов ---
+// SCAN и LOOK ходят вверх и вниз; SCAN доезжает до края диска, LOOK
+// разворачивается на последнем запросе. C-SCAN и C-LOOK обслуживают только
+// при движении вверх и возвращаются к началу. N-step SCAN обслуживает
+// запросы пачками по NSTEP_BATCH в порядке поступления, FSCAN замораживает
+// очередь на время прохода, а новые запросы ждут во второй очереди.
+#define NSTEP_BATCH 16
+
+typedef enum {
+    ELEVATOR_SCAN,
+    ELEVATOR_LOOK,
+    ELEVATOR_CSCAN,
+    ELEVATOR_CLOOK,
+    ELEVATOR_NSTEP,
+    ELEVATOR_FSCAN
+} ElevatorVariant;
 
-            req->start_time = current_time;
-            req->completion_time = current_time + service_time;
-            double response_time = fmax(0.0, req->completion_time - req->arrival_time);
+typedef struct {
+    const DiskRequest* requests;
+    ElevatorVariant variant;
+    int mask;
+    CylinderQueue queues[2];  // для FSCAN активная и ожидающая, иначе используется только первая
+    int active;
+    int direction;            // +1 — к последнему цилиндру, -1 — к нулевому
+    int* arrived;             // N-step SCAN: кольцо запросов, ещё не попавших в пачку
+    int arrived_head, arrived_tail;
+} ElevatorQueue;
+
+static void* elevator_create(const DiskRequest* requests, int capacity, int variant) {
+    ElevatorQueue* q = malloc(sizeof(ElevatorQueue));
+    int* next = malloc(capacity * sizeof(int));
+    q->requests = requests;
+    q->variant = variant;
+    q->mask = capacity - 1;
+    cylinder_queue_init(&q->queues[0], next, q->mask);
+    cylinder_queue_init(&q->queues[1], next, q->mask);
+    q->active = 0;
+    q->direction = 1;
+    q->arrived = variant == ELEVATOR_NSTEP ? malloc(capacity * sizeof(int)) : NULL;
+    q->arrived_head = q->arrived_tail = 0;
+    return q;
+}
 
-            if (response_time < stats->min_time) stats->min_time = response_time;
-            if (response_time > stats->max_time) stats->max_time = response_time;
-            sum_time += response_time;
-            sum_squared_time += response_time * response_time;
+static void elevator_enqueue(void* queue, int index) {
+    ElevatorQueue* q = queue;
+    if (q->variant == ELEVATOR_NSTEP)
+        q->arrived[q->arrived_tail++ & q->mask] = index;
+    else
+        cylinder_queue_push(&q->queues[q->variant == ELEVATOR_FSCAN ? !q->active : q->active],
+                            q->requests[index & q->mask].cylinder, index);
+}
 
-            current_time = req->completion_time;
-            current_cylinder = req->cylinder;
-            current_angle = fmod(current_angle + (rot_latency + transfer_time) / ROTATION_TIME * 360.0, 360.0);
+static int elevator_pick_next(void* queue, const HeadState* head, int* travel) {
+    ElevatorQueue* q = queue;
+    CylinderQueue* active = &q->queues[q->active];
+    if (active->count == 0) {
+        if (q->variant == ELEVATOR_FSCAN) {
+            q->active = !q->active;
+            active = &q->queues[q->active];
+        } else if (q->variant == ELEVATOR_NSTEP) {
+            for (int k = 0; k < NSTEP_BATCH && q->arrived_head < q->arrived_tail; k++) {
+                int index = q->arrived[q->arrived_head++ & q->mask];
+                cylinder_queue_push(active, q->requests[index & q->mask].cylinder, index);
+            }
+        }
+    }
 
-            queue_length--;
+    int current = head->cylinder;
+    int to_edge = q->variant != ELEVATOR_LOOK && q->variant != ELEVATOR_CLOOK;
+    int cylinder;
+    if (q->variant == ELEVATOR_CSCAN || q->variant == ELEVATOR_CLOOK) {
+        cylinder = cylinder_above(active->map, current);
+        if (cylinder != -1) {
+            *travel = cylinder - current;
+        } else {
+            cylinder = cylinder_above(active->map, 0);
+            *travel = to_edge ? (CYLINDERS - 1 - current) + (CYLINDERS - 1) + cylinder : current - cylinder;
+        }
+    } else {
+        cylinder = q->direction > 0 ? cylinder_above(active->map, current) : cylinder_below(active->map, current);
+        if (cylinder != -1) {
+            *travel = abs(cylinder - current);
         } else {
-            if (request_index < total_requests) {
-                double idle_time = requests[request_index].arrival_time - current_time;
-                total_idle_time += idle_time;
-                current_time = requests[request_index].arrival_time;
-            } else break;
+            cylinder = q->direction > 0 ? cylinder_below(active->map, current) : cylinder_above(active->map, current);
+            if (!to_edge) *travel = abs(cylinder - current);
+            else if (q->direction > 0) *travel = (CYLINDERS - 1 - current) + (CYLINDERS - 1 - cylinder);
+            else *travel = current + cylinder;
+            q->direction = -q->direction;
         }
     }
+    return cylinder_queue_pop(active, cylinder);
+}
 
-    stats->max_queue_length = max_queue_length;
-    stats->total_idle_time = total_idle_time;
-    stats->total_requests = total_requests;
-    stats->avg_time = sum_time / total_requests;
-    stats->std_dev = sqrt((sum_squared_time / total_requests) - (stats->avg_time * stats->avg_time));
+static void elevator_destroy(void* queue) {
+    ElevatorQueue* q = queue;
+    free(q->queues[0].next);
+    free(q->arrived);
+    free(q);
 }
 
-// --- SSTF ---
-void simulate_sstf(DiskRequest* requests, int total_requests, SimulationStats* stats) {
-    double current_time = 0;
-    int current_cylinder = 0;
-    double current_angle = 0;
-    int queue_length = 0;
-    int max_queue_length = 0;
-    double total_idle_time = 0;
+static const Scheduler schedulers[] = {
+    {"FIFO",       0,              fifo_create,     fifo_enqueue,     fifo_pick_next,     free},
+    {"SSTF",       0,              sstf_create,     sstf_enqueue,     sstf_pick_next,     sstf_destroy},
+    {"SATF",       0,              satf_create,     satf_enqueue,     satf_pick_next,     satf_destroy,
+     satf_update},
+    {"SCAN",       ELEVATOR_SCAN,  elevator_create, elevator_enqueue, elevator_pick_next, elevator_destroy},
+    {"C-SCAN",     ELEVATOR_CSCAN, elevator_create, elevator_enqueue, elevator_pick_next, elevator_destroy},
+    {"LOOK",       ELEVATOR_LOOK,  elevator_create, elevator_enqueue, elevator_pick_next, elevator_destroy},
+    {"C-LOOK",     ELEVATOR_CLOOK, elevator_create, elevator_enqueue, elevator_pick_next, elevator_destroy},
+    {"N-step SCAN", ELEVATOR_NSTEP, elevator_create, elevator_enqueue, elevator_pick_next, elevator_destroy},
+    {"FSCAN",      ELEVATOR_FSCAN, elevator_create, elevator_enqueue, elevator_pick_next, elevator_destroy},
+};
+#define NUM_SCHEDULERS ((int)(sizeof(schedulers) / sizeof(schedulers[0])))
+
+// --- Дискретно-событийное ядро ---
+// События завершения и начала обслуживания лежат в двоичной куче,
+// поступления берутся по одному из источника запросов. При
+// равном времени сначала идут поступления, затем завершения и ответы из
+// кэша, затем начала обслуживания, чтобы выбор видел все запросы, пришедшие
+// к этому моменту.
+typedef enum {
+    EVENT_DONE,
+    EVENT_HIT,
+    EVENT_START
+} EventType;
+
+typedef struct {
+    double time;
+    int type;
+    int disk;
+    int logical;              // EVENT_HIT: запрос, обслуженный кэшем
+    unsigned long long seq;   // порядок постановки при полном равенстве
+} Event;
 
-    int* in_queue = calloc(total_requests, sizeof(int));
-    int* processed = calloc(total_requests, sizeof(int));
+typedef struct {
+    Event* items;
+    int count;
+    int capacity;
+    unsigned long long next_seq;
+} EventHeap;
+
+static int event_before(const Event* a, const Event* b) {
+    if (a->time != b->time) return a->time < b->time;
+    if (a->type != b->type) return a->type < b->type;
+    return a->seq < b->seq;
+}
+
+static void event_push(EventHeap* heap, double time, int type, int disk, int logical) {
+    if (heap->count == heap->capacity) {
+        heap->capacity = heap->capacity ? heap->capacity * 2 : 16;
+        heap->items = realloc(heap->items, heap->capacity * sizeof(Event));
+    }
+    Event e = {time, type, disk, logical, heap->next_seq++};
+    int i = heap->count++;
+    while (i > 0 && event_before(&e, &heap->items[(i - 1) / 2])) {
+        heap->items[i] = heap->items[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->items[i] = e;
+}
+
+static Event event_pop(EventHeap* heap) {
+    Event top = heap->items[0];
+    Event last = heap->items[--heap->count];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= heap->count) break;
+        if (child + 1 < heap->count && event_before(&heap->items[child + 1], &heap->items[child])) child++;
+        if (!event_before(&heap->items[child], &last)) break;
+        heap->items[i] = heap->items[child];
+        i = child;
+    }
+    if (heap->count > 0) heap->items[i] = last;
+    return top;
+}
 
-    stats->min_time = 1e9;
-    stats->max_time = 0;
-    double sum_time = 0;
-    double sum_squared_time = 0;
+// --- Дисковые массивы ---
+// Набор данных занимает столько дорожек, сколько один диск, а единица
+// чередования — дорожка. RAID-0 раскладывает дорожки по дискам по кругу,
+// RAID-1 зеркалирует их на все диски и читает с ближайшей к головке копии,
+// RAID-5 хранит чётность со сдвигом по полосам и пишет через чтение старых
+// данных и чётности с последующей записью новых.
+typedef enum {
+    RAID_0,
+    RAID_1,
+    RAID_5
+} RaidLevel;
+
+static const char* raid_names[] = {"RAID-0", "RAID-1", "RAID-5"};
+
+// --- Слияние и кэш накопителя ---
+// Слияние, как в блочном уровне ядра: операция, продолжающая ждущую в
+// очереди операцию того же типа на том же цилиндре (или предшествующая ей),
+// пристраивается к ней, пока общий размер не превысит merge_sectors.
+// Кандидаты ищутся по хешам начала и конца ждущих операций.
+//
+// Кэш накопителя состоит из cache_segments сегментов по segment_sectors
+// секторов, каждый хранит непрерывный отрезок LBA. Чтение, целиком лежащее
+// в кэше, отвечает за CACHE_HIT_TIME без движения головки. После промаха
+// диск, пока простаивает, дочитывает сегмент вперёд со скоростью вращения;
+// следующая команда прерывает упреждающее чтение. При отложенной записи
+// запись ложится в кэш и отвечает сразу, а на пластины грязные сегменты
+// сбрасываются, когда очередь диска пуста; если чистых сегментов нет,
+// запись идёт сквозь кэш. Вытесняется самый давно использованный чистый
+// сегмент; в сегментированном LRU сегменты с повторными попаданиями
+// защищены (не больше половины кэша) и вытесняются последними.
+#define MERGE_HASH 4096
+#define CACHE_HIT_TIME 0.2    // мс: разбор команды и передача по интерфейсу
+#define DISK_SECTORS (CYLINDERS * HEADS * SECTORS_PER_TRACK)
+
+typedef enum {
+    CACHE_LRU,
+    CACHE_SLRU
+} CachePolicy;
+
+static const char* cache_policy_names[] = {"LRU", "SLRU"};
 
-    int processed_count = 0;
+typedef struct {
+    int merge_sectors;        // 0 — без слияния
+    int cache_segments;       // 0 — без кэша
+    int segment_sectors;
+    CachePolicy policy;
+    int write_back;
+} DriveConfig;
 
-    while (processed_count < total_requests) {
-        for (int i = 0; i < total_requests; i++) {
-            if (!in_queue[i] && !processed[i] && requests[i].arrival_time <= current_time) {
-                in_queue[i] = 1;
-                queue_length++;
-            }
+typedef struct {
+    RaidLevel level;
+    int disks;
+    const Scheduler* scheduler;
+    DriveConfig drive;
+} ArrayConfig;
+
+typedef struct {
+    int start;                // отрезок LBA [start, end)
+    int end;
+    int valid;
+    int dirty;
+    int protect;              // SLRU: было повторное попадание
+    long long used;
+} CacheSegment;
+
+typedef struct {
+    int logical;
+    int next;
+} MergeLink;
+
+typedef struct {
+    HeadState head;
+    void* queue;
+    DiskRequest* ops;         // кольцо физических операций в порядке постановки
+    int* parent;              // логический запрос каждой операции
+    int* chain;               // первая пристроенная к операции или -1
+    int op_mask;
+    int op_count;
+    MergeLink* links;         // кольцо пристроенных запросов
+    int link_mask;
+    int link_count;
+    int* front;               // хеш начала ждущей операции -> её номер
+    int* back;                // хеш конца ждущей операции -> её номер
+    CacheSegment* cache;
+    long long cache_clock;
+    int dirty_segments;
+    int prefetch;             // сегмент упреждающего чтения или -1
+    int prefetch_base;        // конец сегмента в начале упреждающего чтения
+    double prefetch_since;
+    int destage;              // сбрасываемый сегмент, пока current == -1
+    int queue_length;
+    int busy;
+    int current;              // выполняемая операция
+    int start_pending;        // EVENT_START уже в куче
+    double idle_since;
+} Disk;
+
+// Источник логических запросов в порядке поступления; next возвращает 0,
+// когда запросов сейчас нет. Замкнутому источнику нужны завершения: complete
+// сообщает, что завершился запрос номер logical (номера идут в порядке
+// выдачи). После завершения источник может выдать запрос раньше уже
+// выданного, поэтому движок сначала возвращает непринятый запрос через
+// unread, а потом снова вызывает next.
+typedef struct RequestSource {
+    int (*next)(struct RequestSource* source, DiskRequest* out);
+    void (*complete)(struct RequestSource* source, int logical, double now);
+    void (*unread)(struct RequestSource* source, const DiskRequest* request);
+} RequestSource;
+
+// Логические запросы лежат в кольце из window ячеек: номер i хранится в
+// requests[i & mask]. Новый запрос не принимается, пока не завершён запрос,
+// принятый window запросов назад, — так ведёт себя очередь блочного
+// устройства ограниченной глубины. Для готового массива mask = -1, а window
+// равно числу запросов, и ожидания не бывает.
+typedef struct {
+    const ArrayConfig* config;
+    DiskRequest* requests;
+    int mask;
+    int window;
+    int admitted;
+    int oldest;               // самый старый незавершённый запрос
+    Disk* disks;
+    EventHeap events;
+    int* outstanding;         // незавершённые операции текущей фазы запроса
+    unsigned char* phase;     // RAID-5: 1 — идёт запись после чтения
+    unsigned char* started;
+    RequestSource* source;
+    DiskRequest incoming;     // следующий запрос источника, ещё не принятый
+    int has_incoming;
+    SimulationStats* stats;
+    int completed;
+    double last_completion;
+    double now;
+    long long event_count;
+} ArraySim;
+
+static int op_lba(const DiskRequest* op) {
+    return (op->cylinder * HEADS + op->head) * SECTORS_PER_TRACK + op->sector;
+}
+
+static void submit_logical(ArraySim* sim, int logical);
+
+static void kick_disk(ArraySim* sim, int d) {
+    Disk* disk = &sim->disks[d];
+    if (!disk->busy && !disk->start_pending) {
+        disk->start_pending = 1;
+        event_push(&sim->events, sim->now, EVENT_START, d, -1);
+    }
+}
+
+static void mark_started(ArraySim* sim, int logical) {
+    if (!sim->started[logical & sim->mask]) {
+        sim->started[logical & sim->mask] = 1;
+        sim->requests[logical & sim->mask].start_time = sim->now;
+    }
+}
+
+// Завершает часть логического запроса, выполненную одним диском
+static void finish_part(ArraySim* sim, int logical) {
+    int slot = logical & sim->mask;
+    if (--sim->outstanding[slot] > 0) return;
+    DiskRequest* req = &sim->requests[slot];
+    if (sim->config->level == RAID_5 && req->operation == 1 && !sim->phase[slot]) {
+        sim->phase[slot] = 1;
+        submit_logical(sim, logical);
+        return;
+    }
+    req->completion_time = sim->now;
+    latency_record(&sim->stats->latency, fmax(0.0, req->completion_time - req->arrival_time));
+    while (sim->oldest < sim->admitted && sim->outstanding[sim->oldest & sim->mask] == 0) sim->oldest++;
+    sim->completed++;
+    sim->last_completion = sim->now;
+
+    RequestSource* source = sim->source;
+    if (source->complete) {
+        if (sim->has_incoming) source->unread(source, &sim->incoming);
+        source->complete(source, logical, sim->now);
+        sim->has_incoming = source->next(source, &sim->incoming);
+    }
+}
+
+static void merge_forget(Disk* disk, int index) {
+    const DiskRequest* op = &disk->ops[index & disk->op_mask];
+    int start = op_lba(op);
+    int* front = &disk->front[start & (MERGE_HASH - 1)];
+    int* back = &disk->back[(start + op->num_sectors) & (MERGE_HASH - 1)];
+    if (*front == index) *front = -1;
+    if (*back == index) *back = -1;
+}
+
+static void merge_remember(Disk* disk, int index) {
+    const DiskRequest* op = &disk->ops[index & disk->op_mask];
+    int start = op_lba(op);
+    disk->front[start & (MERGE_HASH - 1)] = index;
+    disk->back[(start + op->num_sectors) & (MERGE_HASH - 1)] = index;
+}
+
+// Пристраивает операцию к ждущей соседней; возвращает 0, если не вышло
+static int try_merge(ArraySim* sim, Disk* disk, const DiskRequest* op, int logical) {
+    int start = op_lba(op);
+    int end = start + op->num_sectors;
+    int candidates[2] = {disk->back[start & (MERGE_HASH - 1)], disk->front[end & (MERGE_HASH - 1)]};
+    for (int k = 0; k < 2; k++) {
+        int index = candidates[k];
+        if (index == -1) continue;
+        DiskRequest* target = &disk->ops[index & disk->op_mask];
+        int target_start = op_lba(target);
+        int adjacent = k == 0 ? target_start + target->num_sectors == start : end == target_start;
+        if (!adjacent || target->cylinder != op->cylinder || target->operation != op->operation ||
+            target->num_sectors + op->num_sectors > sim->config->drive.merge_sectors)
+            continue;
+
+        merge_forget(disk, index);
+        if (k == 1) {
+            target->head = op->head;
+            target->sector = op->sector;
         }
+        target->num_sectors += op->num_sectors;
+        merge_remember(disk, index);
+        if (k == 1 && sim->config->scheduler->update) sim->config->scheduler->update(disk->queue, index);
+
+        int link = disk->link_count++;
+        disk->links[link & disk->link_mask] = (MergeLink){logical, disk->chain[index & disk->op_mask]};
+        disk->chain[index & disk->op_mask] = link;
+        sim->outstanding[logical & sim->mask]++;
+        sim->stats->merged_requests++;
+        return 1;
+    }
+    return 0;
+}
 
-        if (queue_length > max_queue_length)
-            max_queue_length = queue_length;
+// Досчитывает упреждающее чтение, шедшее с prefetch_since до now
+static void cache_settle(Disk* disk, const DriveConfig* drive, double now) {
+    if (disk->prefetch == -1) return;
+    CacheSegment* s = &disk->cache[disk->prefetch];
+    double sectors = (now - disk->prefetch_since) / SECTOR_TIME;
+    int limit = s->start + drive->segment_sectors;
+    if (limit > DISK_SECTORS) limit = DISK_SECTORS;
+    s->end = sectors >= limit - disk->prefetch_base ? limit : disk->prefetch_base + (int)sectors;
+}
 
-        if (queue_length > 0) {
-            int closest_index = -1;
-            int min_distance = CYLINDERS + 1;
-            for (int i = 0; i < total_requests; i++) {
-                if (in_queue[i] && !processed[i]) {
-                    int distance = abs(current_cylinder - requests[i].cylinder);
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        closest_index = i;
-                    }
-                }
-            }
+// Выбрасывает чистые сегменты, пересекающиеся с [start, end)
+static void cache_invalidate(Disk* disk, const DriveConfig* drive, int start, int end) {
+    for (int i = 0; i < drive->cache_segments; i++) {
+        CacheSegment* s = &disk->cache[i];
+        if (s->valid && !s->dirty && s->start < end && start < s->end) {
+            s->valid = 0;
+            if (disk->prefetch == i) disk->prefetch = -1;
+        }
+    }
+}
+
+static int cache_victim(Disk* disk, const DriveConfig* drive) {
+    int best = -1;
+    for (int i = 0; i < drive->cache_segments; i++) {
+        CacheSegment* s = &disk->cache[i];
+        if (!s->valid) return i;
+        if (s->dirty) continue;
+        if (best == -1 || s->protect < disk->cache[best].protect ||
+            (s->protect == disk->cache[best].protect && s->used < disk->cache[best].used))
+            best = i;
+    }
+    return best;
+}
 
-            if (closest_index == -1) break;
+static void cache_touch(Disk* disk, const DriveConfig* drive, int i, int hit) {
+    disk->cache[i].used = ++disk->cache_clock;
+    if (!hit || drive->policy != CACHE_SLRU || disk->cache[i].protect) return;
+    disk->cache[i].protect = 1;
+    int protected_count = 0, oldest = -1;
+    for (int k = 0; k < drive->cache_segments; k++) {
+        CacheSegment* s = &disk->cache[k];
+        if (!s->valid || !s->protect) continue;
+        protected_count++;
+        if (oldest == -1 || s->used < disk->cache[oldest].used) oldest = k;
+    }
+    if (protected_count > drive->cache_segments / 2) disk->cache[oldest].protect = 0;
+}
 
-            DiskRequest* req = &requests[closest_index];
-            double seek_time = calculate_seek_time(current_cylinder, req->cylinder);
-            double rot_latency = calculate_rotational_latency(current_angle, req->sector);
-            double transfer_time = calculate_transfer_time(req->num_sectors, req->operation);
-            double service_time = seek_time + rot_latency + transfer_time;
+static int cache_store(Disk* disk, const DriveConfig* drive, int start, int end, int dirty) {
+    int i = cache_victim(disk, drive);
+    if (i == -1) return -1;
+    if (disk->prefetch == i) disk->prefetch = -1;
+    disk->cache[i] = (CacheSegment){start, end, 1, dirty, 0, 0};
+    cache_touch(disk, drive, i, 0);
+    if (dirty) disk->dirty_segments++;
+    return i;
+}
 
-            req->start_time = current_time;
-            req->completion_time = current_time + service_time;
-            double response_time = fmax(0.0, req->completion_time - req->arrival_time);
+// Обслуживает операцию кэшем; возвращает 1, если диску она не нужна
+static int cache_access(ArraySim* sim, int d, const DiskRequest* op) {
+    Disk* disk = &sim->disks[d];
+    const DriveConfig* drive = &sim->config->drive;
+    int start = op_lba(op);
+    int end = start + op->num_sectors;
+    cache_settle(disk, drive, sim->now);
+
+    if (op->operation == 0) {
+        for (int i = 0; i < drive->cache_segments; i++) {
+            CacheSegment* s = &disk->cache[i];
+            if (s->valid && s->start <= start && end <= s->end) {
+                cache_touch(disk, drive, i, 1);
+                return 1;
+            }
+        }
+        return 0;
+    }
 
-            if (response_time < stats->min_time) stats->min_time = response_time;
-            if (response_time > stats->max_time) stats->max_time = response_time;
-            sum_time += response_time;
-            sum_squared_time += response_time * response_time;
+    cache_invalidate(disk, drive, start, end);
+    if (!drive->write_back || op->num_sectors > drive->segment_sectors) return 0;
+    for (int i = 0; i < drive->cache_segments; i++) {
+        CacheSegment* s = &disk->cache[i];
+        if (s->valid && s->dirty && disk->destage != i && s->end == start && end - s->start <= drive->segment_sectors) {
+            s->end = end;
+            cache_touch(disk, drive, i, 1);
+            return 1;
+        }
+    }
+    if (cache_store(disk, drive, start, end, 1) == -1) return 0;
+    kick_disk(sim, d);
+    return 1;
+}
 
-            current_time = req->completion_time;
-            current_cylinder = req->cylinder;
-            current_angle = fmod(current_angle + (rot_latency + transfer_time) / ROTATION_TIME * 360.0, 360.0);
+static void submit_op(ArraySim* sim, int d, int logical, int track, int operation) {
+    Disk* disk = &sim->disks[d];
+    const DiskRequest* req = &sim->requests[logical & sim->mask];
+    DiskRequest request = *req;
+    request.arrival_time = sim->now;
+    request.cylinder = track / HEADS;
+    request.head = track % HEADS;
+    request.operation = operation;
+
+    if (sim->config->drive.cache_segments && cache_access(sim, d, &request)) {
+        sim->outstanding[logical & sim->mask]++;
+        sim->stats->cache_hits++;
+        mark_started(sim, logical);
+        event_push(&sim->events, sim->now + CACHE_HIT_TIME, EVENT_HIT, d, logical);
+        return;
+    }
+    if (sim->config->drive.merge_sectors && try_merge(sim, disk, &request, logical)) return;
+
+    int index = disk->op_count++;
+    disk->ops[index & disk->op_mask] = request;
+    disk->parent[index & disk->op_mask] = logical;
+    disk->chain[index & disk->op_mask] = -1;
+    if (sim->config->drive.merge_sectors) merge_remember(disk, index);
+    sim->outstanding[logical & sim->mask]++;
+    sim->config->scheduler->enqueue(disk->queue, index);
+    disk->queue_length++;
+    kick_disk(sim, d);
+}
 
-            in_queue[closest_index] = 0;
-            processed[closest_index] = 1;
-            queue_length--;
-            processed_count++;
+// Разбивает логический запрос на операции дисков. Для RAID-5 запись идёт в
+// две фазы: phase 0 читает данные и чётность, phase 1 записывает их.
+static void submit_logical(ArraySim* sim, int logical) {
+    const ArrayConfig* cfg = sim->config;
+    const DiskRequest* req = &sim->requests[logical & sim->mask];
+    int track = req->cylinder * HEADS + req->head;
+    int n = cfg->disks;
+
+    if (cfg->level == RAID_0) {
+        submit_op(sim, track % n, logical, track / n, req->operation);
+    } else if (cfg->level == RAID_1) {
+        if (req->operation == 1) {
+            for (int d = 0; d < n; d++) submit_op(sim, d, logical, track, 1);
+            return;
+        }
+        int best = 0;
+        for (int d = 1; d < n; d++) {
+            int dist = abs(sim->disks[d].head.cylinder - req->cylinder);
+            int best_dist = abs(sim->disks[best].head.cylinder - req->cylinder);
+            if (dist < best_dist || (dist == best_dist && sim->disks[d].queue_length < sim->disks[best].queue_length))
+                best = d;
+        }
+        submit_op(sim, best, logical, track, 0);
+    } else {
+        int stripe = track / (n - 1);
+        int parity = (n - 1) - stripe % n;
+        int data = (parity + 1 + track % (n - 1)) % n;
+        if (req->operation == 0) {
+            submit_op(sim, data, logical, stripe, 0);
         } else {
-            double next_arrival = SIMULATION_TIME + 1;
-            for (int i = 0; i < total_requests; i++)
-                if (!processed[i] && requests[i].arrival_time < next_arrival)
-                    next_arrival = requests[i].arrival_time;
-            if (next_arrival <= SIMULATION_TIME) {
-                total_idle_time += next_arrival - current_time;
-                current_time = next_arrival;
-            } else break;
+            int op = sim->phase[logical & sim->mask] ? 1 : 0;
+            submit_op(sim, data, logical, stripe, op);
+            submit_op(sim, parity, logical, stripe, op);
+        }
+    }
+}
+
+// Сбрасывает на пластины ближайший к головке грязный сегмент
+static double start_destage(Disk* disk, const DriveConfig* drive) {
+    int best = -1, best_dist = 0;
+    for (int i = 0; i < drive->cache_segments; i++) {
+        CacheSegment* s = &disk->cache[i];
+        int dist = abs(s->start / (HEADS * SECTORS_PER_TRACK) - disk->head.cylinder);
+        if (s->valid && s->dirty && (best == -1 || dist < best_dist)) {
+            best = i;
+            best_dist = dist;
         }
     }
+    CacheSegment* s = &disk->cache[best];
+    double seek_time = calculate_travel_time(best_dist);
+    double rot_latency = calculate_rotational_latency(disk->head.angle, s->start % SECTORS_PER_TRACK);
+    double transfer_time = calculate_transfer_time(s->end - s->start, 1);
+    disk->head.cylinder = s->start / (HEADS * SECTORS_PER_TRACK);
+    disk->head.angle = advance_angle(disk->head.angle, (rot_latency + transfer_time) / ROTATION_TIME * 360.0);
+    disk->destage = best;
+    disk->current = -1;
+    return seek_time + rot_latency + transfer_time;
+}
+
+static void start_service(ArraySim* sim, int d, int* max_queue_length, double* total_idle_time) {
+    Disk* disk = &sim->disks[d];
+    const DriveConfig* drive = &sim->config->drive;
+    disk->start_pending = 0;
+    if (disk->busy || (disk->queue_length == 0 && disk->dirty_segments == 0)) return;
+
+    if (disk->queue_length > *max_queue_length)
+        *max_queue_length = disk->queue_length;
+    *total_idle_time += sim->now - disk->idle_since;
+    disk->head.time = sim->now;
+    if (drive->cache_segments) {
+        cache_settle(disk, drive, sim->now);
+        disk->prefetch = -1;
+    }
+    disk->busy = 1;
+
+    if (disk->queue_length == 0) {
+        event_push(&sim->events, sim->now + start_destage(disk, drive), EVENT_DONE, d, -1);
+        return;
+    }
+
+    int travel;
+    int index = sim->config->scheduler->pick_next(disk->queue, &disk->head, &travel);
+    DiskRequest* op = &disk->ops[index & disk->op_mask];
+    if (drive->merge_sectors) merge_forget(disk, index);
+    double seek_time = calculate_travel_time(travel);
+    double rot_latency = calculate_rotational_latency(disk->head.angle, op->sector);
+    double transfer_time = calculate_transfer_time(op->num_sectors, op->operation);
+    double service_time = seek_time + rot_latency + transfer_time;
+
+    op->start_time = sim->now;
+    op->completion_time = sim->now + service_time;
+    mark_started(sim, disk->parent[index & disk->op_mask]);
+    for (int l = disk->chain[index & disk->op_mask]; l != -1; l = disk->links[l & disk->link_mask].next)
+        mark_started(sim, disk->links[l & disk->link_mask].logical);
+
+    disk->head.cylinder = op->cylinder;
+    disk->head.angle = advance_angle(disk->head.angle, (rot_latency + transfer_time) / ROTATION_TIME * 360.0);
+    disk->queue_length--;
+    disk->current = index;
+    event_push(&sim->events, op->completion_time, EVENT_DONE, d, -1);
+}
+
+// Кладёт прочитанное в кэш и начинает упреждающее чтение за ним
+static void cache_fill(Disk* disk, const DriveConfig* drive, const DiskRequest* op, double now) {
+    int start = op_lba(op);
+    int end = start + op->num_sectors;
+    cache_invalidate(disk, drive, start, end);
+    if (op->num_sectors >= drive->segment_sectors) return;
+    disk->prefetch = cache_store(disk, drive, start, end, 0);
+    disk->prefetch_base = end;
+    disk->prefetch_since = now;
+}
+
+// Операция диска выполнена: прочитанное попадает в кэш, а все запросы,
+// пристроенные к операции, завершают свою часть
+static void finish_service(ArraySim* sim, int d) {
+    Disk* disk = &sim->disks[d];
+    const DriveConfig* drive = &sim->config->drive;
+    int index = disk->current;
+    disk->busy = 0;
+    disk->idle_since = sim->now;
+
+    if (index == -1) {
+        disk->cache[disk->destage].dirty = 0;
+        disk->dirty_segments--;
+        disk->destage = -1;
+    } else if (drive->cache_segments && disk->ops[index & disk->op_mask].operation == 0) {
+        cache_fill(disk, drive, &disk->ops[index & disk->op_mask], sim->now);
+    }
+
+    if ((disk->queue_length > 0 || disk->dirty_segments > 0) && !disk->start_pending) {
+        disk->start_pending = 1;
+        event_push(&sim->events, sim->now, EVENT_START, d, -1);
+    }
+    if (index == -1) return;
+    finish_part(sim, disk->parent[index & disk->op_mask]);
+    for (int l = disk->chain[index & disk->op_mask]; l != -1; l = disk->links[l & disk->link_mask].next)
+        finish_part(sim, disk->links[l & disk->link_mask].logical);
+}
+
+static int ring_capacity(int n) {
+    int capacity = 1;
+    while (capacity < n) capacity *= 2;
+    return capacity;
+}
+
+// Общий цикл моделирования массива; каждый диск работает со своим
+// экземпляром планировщика. Статистика считается по логическим запросам,
+// простой суммируется по дискам, очередь — максимум по дискам.
+static void run_array(const ArrayConfig* config, RequestSource* source, DiskRequest* requests, int mask,
+                      int window, SimulationStats* stats, long long* event_count) {
+    int n = config->disks;
+    const DriveConfig* drive = &config->drive;
+    // Незавершённые операции диска принадлежат не более чем 2 * window
+    // соседним логическим запросам, а запись RAID-5 ставит на диск две операции;
+    // то же верно для пристроенных запросов
+    int per_request = config->level == RAID_5 ? 2 : 1;
+    int op_capacity = ring_capacity(mask == -1 ? per_request * window : 2 * per_request * window);
+    int slots = mask == -1 ? window : mask + 1;
+    ArraySim sim = {config, requests, mask, window, 0, 0, calloc(n, sizeof(Disk)), {NULL, 0, 0, 0},
+                    calloc(slots, sizeof(int)), calloc(slots, 1), calloc(slots, 1), source, {0}, 0,
+                    stats, 0, 0, 0, 0};
+    for (int d = 0; d < n; d++) {
+        Disk* disk = &sim.disks[d];
+        disk->ops = malloc(op_capacity * sizeof(DiskRequest));
+        disk->parent = malloc(op_capacity * sizeof(int));
+        disk->chain = malloc(op_capacity * sizeof(int));
+        disk->op_mask = op_capacity - 1;
+        disk->queue = config->scheduler->create(disk->ops, op_capacity, config->scheduler->variant);
+        disk->prefetch = disk->destage = -1;
+        if (drive->merge_sectors) {
+            disk->links = malloc(op_capacity * sizeof(MergeLink));
+            disk->link_mask = op_capacity - 1;
+            disk->front = malloc(MERGE_HASH * sizeof(int));
+            disk->back = malloc(MERGE_HASH * sizeof(int));
+            memset(disk->front, -1, MERGE_HASH * sizeof(int));
+            memset(disk->back, -1, MERGE_HASH * sizeof(int));
+        }
+        if (drive->cache_segments) disk->cache = calloc(drive->cache_segments, sizeof(CacheSegment));
+    }
+
+    int max_queue_length = 0;
+    double total_idle_time = 0;
+    latency_reset(&stats->latency);
+    stats->merged_requests = 0;
+    stats->cache_hits = 0;
+
+    sim.has_incoming = source->next(source, &sim.incoming);
+
+    while (sim.has_incoming || sim.events.count > 0) {
+        if (sim.has_incoming && sim.admitted - sim.oldest < sim.window &&
+            (sim.events.count == 0 || sim.incoming.arrival_time <= sim.events.items[0].time)) {
+            // Запрос, ждавший места в очереди, принимается в момент её освобождения
+            sim.now = fmax(sim.now, sim.incoming.arrival_time);
+            sim.event_count++;
+            int logical = sim.admitted++;
+            sim.requests[logical & mask] = sim.incoming;
+            sim.phase[logical & mask] = 0;
+            sim.started[logical & mask] = 0;
+            sim.has_incoming = source->next(source, &sim.incoming);
+            submit_logical(&sim, logical);
+            continue;
+        }
+
+        Event e = event_pop(&sim.events);
+        sim.now = e.time;
+        sim.event_count++;
+        if (e.type == EVENT_START)
+            start_service(&sim, e.disk, &max_queue_length, &total_idle_time);
+        else if (e.type == EVENT_HIT)
+            finish_part(&sim, e.logical);
+        else
+            finish_service(&sim, e.disk);
+    }
 
     stats->max_queue_length = max_queue_length;
     stats->total_idle_time = total_idle_time;
-    stats->total_requests = processed_count;
-    stats->avg_time = sum_time / processed_count;
-    stats->std_dev = sqrt((sum_squared_time / processed_count) - (stats->avg_time * stats->avg_time));
+    stats->total_requests = sim.completed;
+    stats->min_time = stats->latency.min;
+    stats->max_time = stats->latency.max;
+    stats->avg_time = stats->latency.mean;
+    stats->std_dev = latency_std_dev(&stats->latency);
+    stats->p50_time = latency_percentile(&stats->latency, 0.5);
+    stats->p90_time = latency_percentile(&stats->latency, 0.9);
+    stats->p99_time = latency_percentile(&stats->latency, 0.99);
+    stats->p999_time = latency_percentile(&stats->latency, 0.999);
+    // Сброс грязных сегментов после последнего ответа в пропускную способность не входит
+    stats->throughput = sim.last_completion > 0 ? sim.completed / (sim.last_completion / 1000.0) : 0;
+    if (event_count) *event_count = sim.event_count;
+
+    for (int d = 0; d < n; d++) {
+        Disk* disk = &sim.disks[d];
+        config->scheduler->destroy(disk->queue);
+        free(disk->ops);
+        free(disk->parent);
+        free(disk->chain);
+        free(disk->links);
+        free(disk->front);
+        free(disk->back);
+        free(disk->cache);
+    }
+    free(sim.disks);
+    free(sim.events.items);
+    free(sim.outstanding);
+    free(sim.phase);
+    free(sim.started);
+}
 
-    free(in_queue);
-    free(processed);
+typedef struct {
+    RequestSource source;
+    const DiskRequest* requests;
+    int count;
+    int position;
+} ArraySource;
+
+static int array_next(RequestSource* source, DiskRequest* out) {
+    ArraySource* s = (ArraySource*)source;
+    if (s->position == s->count) return 0;
+    *out = s->requests[s->position++];
+    return 1;
 }
 
-int compare_doubles(const void* a, const void* b) {
-    double da = *(const double*)a;
-    double db = *(const double*)b;
-    return (da > db) - (da < db);
+// Моделирует массив дисков на готовом массиве запросов; времена начала и
+// завершения записываются в сами запросы
+void simulate_array(const ArrayConfig* config, DiskRequest* requests, int total_requests,
+                    SimulationStats* stats, long long* event_count) {
+    ArraySource source = {{array_next}, requests, total_requests, 0};
+    run_array(config, &source.source, requests, -1, total_requests, stats, event_count);
 }
 
-void create_histogram(DiskRequest* requests, int total_requests, const char* strategy_name) {
-    if (total_requests == 0) return;
+// Моделирует массив дисков на потоке запросов, храня не больше window
+// логических запросов одновременно
+void simulate_source(const ArrayConfig* config, RequestSource* source, int window,
+                     SimulationStats* stats, long long* event_count) {
+    window = ring_capacity(window);
+    DiskRequest* ring = malloc(window * sizeof(DiskRequest));
+    run_array(config, source, ring, window - 1, window, stats, event_count);
+    free(ring);
+}
 
-    double* service_times = malloc(total_requests * sizeof(double));
-    for (int i = 0; i < total_requests; i++)
-        service_times[i] = fmax(0.0, requests[i].completion_time - requests[i].arrival_time);
+// Один диск — это массив RAID-0 из одного диска
+void simulate(const Scheduler* scheduler, DiskRequest* requests, int total_requests, SimulationStats* stats) {
+    ArrayConfig config = {RAID_0, 1, scheduler};
+    simulate_array(&config, requests, total_requests, stats, NULL);
+}
 
-    double min_time = service_times[0], max_time = service_times[0], mean = 0;
-    for (int i = 0; i < total_requests; i++) {
-        if (service_times[i] < min_time) min_time = service_times[i];
-        if (service_times[i] > max_time) max_time = service_times[i];
-        mean += service_times[i];
-    }
-    mean /= total_requests;
+// Гистограмма строится по корзинам HDR-гистограммы. Корзина может
+// накрывать несколько интервалов графика, и её запросы делятся между ними
+// пропорционально перекрытию
+void create_histogram(const LatencyStats* latency, const char* strategy_name) {
+    if (latency->count == 0) return;
 
-    qsort(service_times, total_requests, sizeof(double), compare_doubles);
-    double median = (total_requests % 2 == 0)
-        ? (service_times[total_requests/2 - 1] + service_times[total_requests/2]) / 2.0
-        : service_times[total_requests/2];
+    double min_time = latency->min, max_time = latency->max, mean = latency->mean;
+    double median = latency_percentile(latency, 0.5);
 
-    int num_bins = (int)sqrt(total_requests);
+    int num_bins = (int)sqrt((double)latency->count);
     if (num_bins < 10) num_bins = 10;
     if (num_bins > 40) num_bins = 40;
 
@@ -280,11 +1417,25 @@ void create_histogram(DiskRequest* requests, int total_requests, const char* str
         bins[i].count = 0;
     }
 
-    for (int i = 0; i < total_requests; i++) {
-        int idx = (int)((service_times[i] - min_time) / bin_width);
-        if (idx >= num_bins) idx = num_bins - 1;
-        bins[idx].count++;
+    double* shares = calloc(num_bins, sizeof(double));
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        if (latency->buckets[b] == 0) continue;
+        double low, high;
+        latency_bucket_range(b, &low, &high);
+        low = fmin(fmax(low, min_time), max_time);
+        high = fmin(fmax(high, min_time), max_time);
+        int first = bin_width > 0 ? (int)((low - min_time) / bin_width) : 0;
+        int last = bin_width > 0 ? (int)((high - min_time) / bin_width) : 0;
+        if (first >= num_bins) first = num_bins - 1;
+        if (last >= num_bins) last = num_bins - 1;
+        for (int i = first; i <= last; i++) {
+            double overlap = high > low ? (fmin(high, bins[i].max) - fmax(low, bins[i].min)) / (high - low) : 1;
+            if (first == last) overlap = 1;
+            shares[i] += latency->buckets[b] * overlap;
+        }
     }
+    for (int i = 0; i < num_bins; i++) bins[i].count = (int)llround(shares[i]);
+    free(shares);
 
     int max_count = 0;
     for (int i = 0; i < num_bins; i++)
@@ -300,7 +1451,7 @@ void create_histogram(DiskRequest* requests, int total_requests, const char* str
     printf("-----------------------------------------------------------------------\n");
 
     for (int i = 0; i < num_bins; i++) {
-        double percent = (bins[i].count * 100.0) / total_requests;
+        double percent = (bins[i].count * 100.0) / latency->count;
         int bar_length = (bins[i].count * 50) / (max_count ? max_count : 1);
         printf("%7.2f – %-9.2f %6d  %6.2f%% | ", bins[i].min, bins[i].max, bins[i].count, percent);
         for (int j = 0; j < bar_length; j++) printf("█");
@@ -310,16 +1461,898 @@ void create_histogram(DiskRequest* requests, int total_requests, const char* str
     printf("-----------------------------------------------------------------------\n");
     printf("Среднее: %.2f мс | Медиана: %.2f мс | Мин: %.2f | Макс: %.2f\n",
            mean, median, min_time, max_time);
+    printf("p90: %.2f мс | p99: %.2f мс | p99.9: %.2f мс | Std: %.2f\n",
+           latency_percentile(latency, 0.9), latency_percentile(latency, 0.99),
+           latency_percentile(latency, 0.999), latency_std_dev(latency));
     printf("═══════════════════════════════════════════════════════════════════════\n");
 
-    free(service_times);
     free(bins);
 }
 
-int main() {
+// --- Серия прогонов ---
+// Сетка t_max x n x seed x стратегия раскладывается по потокам пулом с
+// перехватом работы: у каждого потока своя дека прогонов, он берёт работу
+// с конца своей деки, а закончив её, забирает прогоны с начала чужих.
+// Прогоны одной точки (t_max, n, seed) видят одинаковый поток запросов, а
+// строки выводятся в порядке сетки, так что результат не зависит от числа
+// потоков.
+#define SWEEP_MAX_VALUES 64
+
+typedef struct {
+    double t_max;
+    int n;
+    uint64_t seed;
+    int scheduler;
+    SimulationStats stats;
+} SweepRun;
+
+typedef struct {
+    pthread_mutex_t lock;
+    int* runs;
+    int top;        // отсюда забирают другие потоки
+    int bottom;     // здесь работает владелец
+} WorkDeque;
+
+typedef struct {
+    SweepRun* runs;
+    WorkDeque* deques;
+    int workers;
+    int id;
+} SweepWorker;
+
+static int deque_take(WorkDeque* d, int own) {
+    int run = -1;
+    pthread_mutex_lock(&d->lock);
+    if (d->top < d->bottom) run = own ? d->runs[--d->bottom] : d->runs[d->top++];
+    pthread_mutex_unlock(&d->lock);
+    return run;
+}
+
+static void execute_run(SweepRun* run) {
+    int total_requests;
+    DiskRequest* requests = generate_requests(run->t_max, run->n, run->seed, &total_requests);
+    memset(&run->stats, 0, sizeof(run->stats));
+    simulate(&schedulers[run->scheduler], requests, total_requests, &run->stats);
+    free(requests);
+}
+
+static void* sweep_worker(void* arg) {
+    SweepWorker* w = arg;
+    for (;;) {
+        int run = deque_take(&w->deques[w->id], 1);
+        // Новые прогоны не появляются, поэтому пустые деки у всех — это конец
+        for (int k = 1; run == -1 && k < w->workers; k++)
+            run = deque_take(&w->deques[(w->id + k) % w->workers], 0);
+        if (run == -1) return NULL;
+        execute_run(&w->runs[run]);
+    }
+}
+
+static int parse_doubles(const char* text, double* values) {
+    int count = 0;
+    char* end;
+    while (*text && count < SWEEP_MAX_VALUES) {
+        values[count] = strtod(text, &end);
+        if (end == text || values[count] <= 0) return -1;
+        count++;
+        text = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return -1;
+    }
+    return count;
+}
+
+// Список чисел через запятую, элемент может быть диапазоном a-b
+static int parse_integers(const char* text, uint64_t* values) {
+    int count = 0;
+    char* end;
+    while (*text) {
+        uint64_t from = strtoull(text, &end, 10), to = from;
+        if (end == text) return -1;
+        if (*end == '-') {
+            const char* next = end + 1;
+            to = strtoull(next, &end, 10);
+            if (end == next || to < from) return -1;
+        }
+        if (*end && *end != ',') return -1;
+        for (uint64_t v = from; v <= to; v++) {
+            if (count == SWEEP_MAX_VALUES) return -1;
+            values[count++] = v;
+        }
+        text = *end ? end + 1 : end;
+    }
+    return count;
+}
+
+static int find_scheduler(const char* name, int length) {
+    for (int k = 0; k < NUM_SCHEDULERS; k++)
+        if ((int)strlen(schedulers[k].name) == length && strncasecmp(schedulers[k].name, name, length) == 0)
+            return k;
+    return -1;
+}
+
+// Разбирает "all" или список имён через запятую; возвращает число
+// стратегий или 0 при ошибке
+static int parse_strategies(const char* text, int* strategies) {
+    if (strcasecmp(text, "all") == 0) {
+        for (int k = 0; k < NUM_SCHEDULERS; k++) strategies[k] = k;
+        return NUM_SCHEDULERS;
+    }
+    int count = 0;
+    for (const char* p = text; *p; ) {
+        const char* comma = strchr(p, ',');
+        int length = comma ? (int)(comma - p) : (int)strlen(p);
+        int k = find_scheduler(p, length);
+        if (k == -1 || count == NUM_SCHEDULERS) return 0;
+        strategies[count++] = k;
+        p += comma ? length + 1 : length;
+    }
+    return count;
+}
+
+static void sweep_usage() {
+    printf("Использование: ./2 sweep [--t-max 2,0.2,0.02] [--n 16] [--strategy all|FIFO,SSTF,...]\n");
+    printf("                         [--seeds 1-4] [--threads N] [--format csv|json]\n");
+}
+
+int run_sweep(int argc, char* argv[]) {
+    double t_max_values[SWEEP_MAX_VALUES] = {2.0, 0.2, 0.02};
+    uint64_t n_values[SWEEP_MAX_VALUES] = {16};
+    uint64_t seeds[SWEEP_MAX_VALUES] = {1};
+    int strategies[NUM_SCHEDULERS];
+    int num_t_max = 3, num_n = 1, num_seeds = 1, num_strategies = NUM_SCHEDULERS;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int json = 0;
+    for (int k = 0; k < NUM_SCHEDULERS; k++) strategies[k] = k;
+
+    for (int i = 0; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        int ok = value != NULL;
+        if (ok && strcmp(argv[i], "--t-max") == 0) {
+            ok = (num_t_max = parse_doubles(value, t_max_values)) > 0;
+        } else if (ok && strcmp(argv[i], "--n") == 0) {
+            ok = (num_n = parse_integers(value, n_values)) > 0;
+            for (int k = 0; ok && k < num_n; k++) ok = n_values[k] > 0 && n_values[k] <= 1000000;
+        } else if (ok && strcmp(argv[i], "--seeds") == 0) {
+            ok = (num_seeds = parse_integers(value, seeds)) > 0;
+        } else if (ok && strcmp(argv[i], "--threads") == 0) {
+            ok = (threads = atoi(value)) > 0;
+        } else if (ok && strcmp(argv[i], "--format") == 0) {
+            json = strcmp(value, "json") == 0;
+            ok = json || strcmp(value, "csv") == 0;
+        } else if (ok && strcmp(argv[i], "--strategy") == 0) {
+            ok = (num_strategies = parse_strategies(value, strategies)) > 0;
+        } else {
+            ok = 0;
+        }
+        if (!ok) {
+            printf("Неверный параметр: %s %s\n", argv[i], value ? value : "");
+            sweep_usage();
+            return 1;
+        }
+        i++;
+    }
+
+    int total_runs = num_t_max * num_n * num_seeds * num_strategies;
+    if (threads > total_runs) threads = total_runs;
+    SweepRun* runs = malloc(total_runs * sizeof(SweepRun));
+    int r = 0;
+    for (int a = 0; a < num_t_max; a++)
+        for (int b = 0; b < num_n; b++)
+            for (int c = 0; c < num_seeds; c++)
+                for (int d = 0; d < num_strategies; d++)
+                    runs[r++] = (SweepRun){t_max_values[a], (int)n_values[b], seeds[c], strategies[d]};
+
+    // Каждому потоку достаётся непрерывный кусок сетки; прогоны с малым
+    // t_max идут дольше, и перекос выравнивается перехватом
+    WorkDeque* deques = malloc(threads * sizeof(WorkDeque));
+    SweepWorker* workers = malloc(threads * sizeof(SweepWorker));
+    pthread_t* tids = malloc(threads * sizeof(pthread_t));
+    int* order = malloc(total_runs * sizeof(int));
+    for (int k = 0; k < total_runs; k++) order[k] = k;
+    for (int t = 0; t < threads; t++) {
+        pthread_mutex_init(&deques[t].lock, NULL);
+        deques[t].runs = order;
+        deques[t].top = (int)((long long)total_runs * t / threads);
+        deques[t].bottom = (int)((long long)total_runs * (t + 1) / threads);
+        workers[t] = (SweepWorker){runs, deques, threads, t};
+    }
+    for (int t = 1; t < threads; t++) pthread_create(&tids[t], NULL, sweep_worker, &workers[t]);
+    sweep_worker(&workers[0]);
+    for (int t = 1; t < threads; t++) pthread_join(tids[t], NULL);
+
+    if (!json)
+        printf("t_max,n,seed,strategy,requests,avg_ms,p50_ms,p90_ms,p99_ms,p999_ms,max_ms,min_ms,std_ms,"
+               "max_queue,idle_ms,throughput\n");
+    else
+        printf("[\n");
+    for (int k = 0; k < total_runs; k++) {
+        SweepRun* run = &runs[k];
+        SimulationStats* st = &run->stats;
+        if (!json)
+            printf("%g,%d,%llu,%s,%d,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%d,%.6f,%.6f\n", run->t_max, run->n,
+                   (unsigned long long)run->seed, schedulers[run->scheduler].name, st->total_requests,
+                   st->avg_time, st->p50_time, st->p90_time, st->p99_time, st->p999_time,
+                   st->max_time, st->min_time, st->std_dev,
+                   st->max_queue_length, st->total_idle_time, st->throughput);
+        else
+            printf("  {\"t_max\": %g, \"n\": %d, \"seed\": %llu, \"strategy\": \"%s\", \"requests\": %d, "
+                   "\"avg_ms\": %.6f, \"p50_ms\": %.6f, \"p90_ms\": %.6f, \"p99_ms\": %.6f, \"p999_ms\": %.6f, "
+                   "\"max_ms\": %.6f, \"min_ms\": %.6f, \"std_ms\": %.6f, "
+                   "\"max_queue\": %d, \"idle_ms\": %.6f, \"throughput\": %.6f}%s\n", run->t_max, run->n,
+                   (unsigned long long)run->seed, schedulers[run->scheduler].name, st->total_requests,
+                   st->avg_time, st->p50_time, st->p90_time, st->p99_time, st->p999_time,
+                   st->max_time, st->min_time, st->std_dev,
+                   st->max_queue_length, st->total_idle_time, st->throughput, k + 1 < total_runs ? "," : "");
+    }
+    if (json) printf("]\n");
+
+    for (int t = 0; t < threads; t++) pthread_mutex_destroy(&deques[t].lock);
+    free(runs);
+    free(deques);
+    free(workers);
+    free(tids);
+    free(order);
+    return 0;
+}
+
+// --- Сравнение массивов ---
+static double wall_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+int run_raid(int argc, char* argv[]) {
+    int disks = argc > 0 ? atoi(argv[0]) : 4;
+    double t_max = argc > 1 ? atof(argv[1]) : 0.01;
+    uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 10) : 1;
+    int n = 16;
+    if (disks < 3 || t_max <= 0) {
+        printf("Использование: ./2 raid [дисков >= 3] [t_max] [seed]\n");
+        return 1;
+    }
+
+    int total_requests;
+    DiskRequest* requests = generate_requests(t_max, n, seed, &total_requests);
+    DiskRequest* copy = malloc(total_requests * sizeof(DiskRequest));
+    printf("Массивы из %d дисков: t_max = %.3f с, n = %d, запросов: %d\n\n", disks, t_max, n, total_requests);
+    printf("%-13s %-21s %13s %10s %14s %21s %20s\n", "Массив", "Стратегия", "Среднее", "p99", "Макс",
+           "Запросов/с", "Событий/с");
+
+    for (int level = RAID_0; level <= RAID_5; level++) {
+        for (int k = 0; k < NUM_SCHEDULERS; k++) {
+            ArrayConfig config = {level, disks, &schedulers[k]};
+            SimulationStats stats = {0};
+            long long events;
+            memcpy(copy, requests, total_requests * sizeof(DiskRequest));
+            double t0 = wall_ms();
+            simulate_array(&config, copy, total_requests, &stats, &events);
+            double elapsed = wall_ms() - t0;
+            printf("%-7s %-12s %10.2f %10.2f %10.2f %12.1f %12.0f\n", raid_names[level], schedulers[k].name,
+                   stats.avg_time, stats.p99_time, stats.max_time, stats.throughput,
+                   elapsed > 0 ? events / (elapsed / 1000.0) : 0);
+        }
+    }
+
+    free(requests);
+    free(copy);
+    return 0;
+}
+
+// --- Замер ядра SATF ---
+// Все ждущие запросы оцениваются по цилиндрам двумя способами: по спискам
+// из массива структур через satf_cost, как раньше, и ядром satf_score по
+// столбцам. Лучший запрос обоих способов должен совпасть.
+int run_bench_satf(int argc, char* argv[]) {
+    int total = argc > 0 ? atoi(argv[0]) : 1 << 20;
+    int rounds = 16;
+    if (total <= 0) {
+        printf("Использование: ./2 bench-satf [запросов]\n");
+        return 1;
+    }
+    int capacity = 1;
+    while (capacity < total) capacity *= 2;
+
+    Rng rng = rng_make(7, 0);
+    DiskRequest* requests = calloc(capacity, sizeof(DiskRequest));
+    CylinderQueue lists;
+    cylinder_queue_init(&lists, malloc(capacity * sizeof(int)), capacity - 1);
+    SatfQueue* columns = satf_create(requests, capacity, 0);
+    double time = 0;
+    for (int i = 0; i < total; i++) {
+        time += rng_uniform(&rng);
+        requests[i].arrival_time = time;
+        requests[i].cylinder = rng_below(&rng, CYLINDERS);
+        requests[i].sector = rng_below(&rng, SECTORS_PER_TRACK);
+        cylinder_queue_push(&lists, requests[i].cylinder, i);
+        satf_enqueue(columns, i);
+    }
+
+    double scalar_ms = 0, batch_ms = 0;
+    int mismatches = 0;
+    for (int r = 0; r < rounds; r++) {
+        HeadState head = {time, rng_below(&rng, CYLINDERS), rng_uniform(&rng) * 360.0};
+
+        double t0 = wall_ms();
+        int scalar_best = -1;
+        double scalar_cost = 0;
+        for (int c = 0; c < CYLINDERS; c++) {
+            for (int i = lists.head[c]; i != -1; i = cylinder_queue_next(&lists, i)) {
+                double cost = satf_cost(&requests[i], &head);
+                if (scalar_best == -1 || cost < scalar_cost) {
+                    scalar_best = i;
+                    scalar_cost = cost;
+                }
+            }
+        }
+        double t1 = wall_ms();
+        int batch_best = -1;
+        double batch_cost = 0;
+        for (int c = 0; c < CYLINDERS; c++) {
+            SatfBucket* b = &columns->buckets[c];
+            satf_score(b->arrival, b->sector, b->count, calculate_seek_time(head.cylinder, c), &head, columns->cost);
+            for (int k = 0; k < b->count; k++) {
+                if (batch_best == -1 || columns->cost[k] < batch_cost) {
+                    batch_best = b->index[k];
+                    batch_cost = columns->cost[k];
+                }
+            }
+        }
+        double t2 = wall_ms();
+        scalar_ms += t1 - t0;
+        batch_ms += t2 - t1;
+        mismatches += scalar_best != batch_best || scalar_cost != batch_cost;
+    }
+
+    double evaluated = (double)total * rounds;
+    printf("Оценка SATF: %d запросов, %d положений головки\n", total, rounds);
+    printf("Массив структур, satf_cost: %8.2f нс/запрос\n", scalar_ms * 1e6 / evaluated);
+    printf("Столбцы, satf_score:        %8.2f нс/запрос\n", batch_ms * 1e6 / evaluated);
+    printf("Ускорение: %.2fx, расхождений: %d\n", batch_ms > 0 ? scalar_ms / batch_ms : 0, mismatches);
+
+    satf_destroy(columns);
+    free(lists.next);
+    free(requests);
+    return mismatches != 0;
+}
+
+// --- Слияние и кэш ---
+#define CACHE_SEGMENTS 16
+#define CACHE_SEGMENT_SECTORS 64
+#define MERGE_SECTORS 128
+
+static void print_drive_config(const DriveConfig* drive) {
+    if (drive->merge_sectors) printf("Слияние до %d секторов\n", drive->merge_sectors);
+    if (drive->cache_segments)
+        printf("Кэш: %d сегментов по %d секторов, %s, %s\n", drive->cache_segments, drive->segment_sectors,
+               cache_policy_names[drive->policy], drive->write_back ? "отложенная запись" : "сквозная запись");
+    if (!drive->merge_sectors && !drive->cache_segments) printf("Без слияния и кэша\n");
+}
+
+int run_cache(int argc, char* argv[]) {
+    double t_max = argc > 0 ? atof(argv[0]) : 0.02;
+    uint64_t seed = argc > 1 ? strtoull(argv[1], NULL, 10) : 1;
+    int n = 16;
+    if (t_max <= 0) {
+        printf("Использование: ./2 cache [t_max] [seed]\n");
+        return 1;
+    }
+    DriveConfig modes[] = {
+        {0, 0, CACHE_SEGMENT_SECTORS, CACHE_LRU, 0},
+        {MERGE_SECTORS, 0, CACHE_SEGMENT_SECTORS, CACHE_LRU, 0},
+        {0, CACHE_SEGMENTS, CACHE_SEGMENT_SECTORS, CACHE_LRU, 0},
+        {0, CACHE_SEGMENTS, CACHE_SEGMENT_SECTORS, CACHE_SLRU, 0},
+        {0, CACHE_SEGMENTS, CACHE_SEGMENT_SECTORS, CACHE_SLRU, 1},
+        {MERGE_SECTORS, CACHE_SEGMENTS, CACHE_SEGMENT_SECTORS, CACHE_SLRU, 1},
+    };
+
+    int total_requests;
+    DiskRequest* requests = generate_requests(t_max, n, seed, &total_requests);
+    DiskRequest* copy = malloc(total_requests * sizeof(DiskRequest));
+    printf("Слияние и кэш накопителя: t_max = %.3f с, n = %d, запросов: %d\n", t_max, n, total_requests);
+
+    for (int m = 0; m < (int)(sizeof(modes) / sizeof(modes[0])); m++) {
+        printf("\n");
+        print_drive_config(&modes[m]);
+        printf("%-21s %13s %10s %21s %17s %20s\n", "Стратегия", "Среднее", "p99", "Запросов/с", "Слияний",
+               "Попаданий");
+        for (int k = 0; k < NUM_SCHEDULERS; k++) {
+            ArrayConfig config = {RAID_0, 1, &schedulers[k], modes[m]};
+            SimulationStats stats = {0};
+            memcpy(copy, requests, total_requests * sizeof(DiskRequest));
+            simulate_array(&config, copy, total_requests, &stats, NULL);
+            printf("%-12s %10.2f %10.2f %12.1f %10d %10d\n", schedulers[k].name, stats.avg_time,
+                   stats.p99_time, stats.throughput, stats.merged_requests, stats.cache_hits);
+        }
+    }
+
+    free(requests);
+    free(copy);
+    return 0;
+}
+
+// --- Трассы ---
+// Трасса читается кусками по TRACE_CHUNK байт, поэтому в памяти лежит только
+// текущий кусок, а вход может быть и каналом ("-" — стандартный ввод).
+// Понимаются два формата строк:
+//   CSV: время_мс,LBA,секторов,операция (R/W или 0/1);
+//   blkparse: "8,0 1 1 0.000012345 123 Q W 2048 + 8 [dd]", берутся только
+//   действия Q (время в секундах).
+// Заголовки, комментарии (#) и прочие строки пропускаются. LBA
+// раскладывается по геометрии диска и заворачивается по его ёмкости;
+// время отсчитывается от первой записи и не убывает.
+#define TRACE_CHUNK (1 << 20)
+
+typedef struct {
+    RequestSource source;
+    FILE* file;
+    char* chunk;
+    int length;               // байт в куске
+    int position;             // начало следующей строки
+    int discard;              // хвост строки длиннее куска
+    long long lines;
+    long long skipped;
+    double origin;
+    double last;
+    int started;
+} TraceSource;
+
+static char* trace_line(TraceSource* t) {
+    for (;;) {
+        char* start = t->chunk + t->position;
+        char* end = memchr(start, '\n', t->length - t->position);
+        if (end) {
+            *end = '\0';
+            t->position = (int)(end - t->chunk) + 1;
+            if (t->discard) {
+                t->discard = 0;
+                continue;
+            }
+            return start;
+        }
+        int rest = t->length - t->position;
+        if (rest == TRACE_CHUNK) {
+            t->discard = 1;
+            t->skipped++;
+            rest = 0;
+        }
+        memmove(t->chunk, start, rest);
+        t->position = 0;
+        t->length = rest;
+        size_t got = fread(t->chunk + rest, 1, TRACE_CHUNK - rest, t->file);
+        if (got == 0) {
+            if (rest == 0 || t->discard) return NULL;
+            // Последняя строка без перевода строки
+            t->chunk[rest] = '\0';
+            t->position = rest;
+            return t->chunk;
+        }
+        t->length += (int)got;
+    }
+}
+
+static int trace_parse(const char* line, double* time_ms, unsigned long long* lba,
+                       unsigned long long* sectors, int* operation) {
+    char action[8], op[16];
+    double t;
+    if (sscanf(line, "%*s %*d %*u %lf %*d %7s %15s %llu + %llu", &t, action, op, lba, sectors) == 5) {
+        if (strcmp(action, "Q") != 0) return 0;
+        *time_ms = t * 1000.0;
+        *operation = strchr(op, 'W') != NULL;
+        return 1;
+    }
+    if (sscanf(line, "%lf , %llu , %llu , %15[^, \t\r\n]", &t, lba, sectors, op) == 4) {
+        *time_ms = t;
+        *operation = op[0] == 'W' || op[0] == 'w' || op[0] == '1';
+        return 1;
+    }
+    return 0;
+}
+
+static int trace_next(RequestSource* source, DiskRequest* out) {
+    TraceSource* t = (TraceSource*)source;
+    const unsigned long long capacity = (unsigned long long)CYLINDERS * HEADS * SECTORS_PER_TRACK;
+    char* line;
+    while ((line = trace_line(t)) != NULL) {
+        t->lines++;
+        while (*line == ' ' || *line == '\t') line++;
+        if (*line == '\0' || *line == '\r' || *line == '#') continue;
+
+        double time_ms;
+        unsigned long long lba, sectors;
+        int operation;
+        if (!trace_parse(line, &time_ms, &lba, &sectors, &operation)) {
+            t->skipped++;
+            continue;
+        }
+        if (!t->started) {
+            t->started = 1;
+            t->origin = time_ms;
+        }
+        time_ms -= t->origin;
+        if (time_ms < t->last) time_ms = t->last;
+        t->last = time_ms;
+
+        lba %= capacity;
+        out->arrival_time = time_ms;
+        out->sector = (int)(lba % SECTORS_PER_TRACK);
+        out->head = (int)(lba / SECTORS_PER_TRACK % HEADS);
+        out->cylinder = (int)(lba / (SECTORS_PER_TRACK * HEADS));
+        out->operation = operation;
+        out->num_sectors = sectors == 0 ? 1 : sectors > 65536 ? 65536 : (int)sectors;
+        out->start_time = 0;
+        out->completion_time = 0;
+        return 1;
+    }
+    return 0;
+}
+
+static int trace_open(TraceSource* t, const char* path) {
+    memset(t, 0, sizeof(*t));
+    t->source.next = trace_next;
+    t->file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (!t->file) return 0;
+    t->chunk = malloc(TRACE_CHUNK + 1);
+    return 1;
+}
+
+static void trace_close(TraceSource* t) {
+    if (t->file && t->file != stdin) fclose(t->file);
+    free(t->chunk);
+}
+
+static void trace_usage() {
+    printf("Использование: ./2 trace ФАЙЛ|- [--disks N] [--raid 0|1|5] [--strategy SSTF|all|FIFO,...]\n");
+    printf("                               [--window 128] [--merge СЕКТОРОВ] [--cache 16x64]\n");
+    printf("                               [--policy lru|slru] [--write-back 0|1]\n");
+}
+
+int run_trace(int argc, char* argv[]) {
+    int disks = 1, level = RAID_0, window = 128;
+    DriveConfig drive = {0, 0, CACHE_SEGMENT_SECTORS, CACHE_LRU, 0};
+    int strategies[NUM_SCHEDULERS];
+    int num_strategies = parse_strategies("SSTF", strategies);
+    int ok = argc > 0;
+    for (int i = 1; ok && i < argc; i += 2) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        ok = value != NULL;
+        if (ok && strcmp(argv[i], "--disks") == 0) {
+            ok = (disks = atoi(value)) > 0 && disks <= 64;
+        } else if (ok && strcmp(argv[i], "--raid") == 0) {
+            level = atoi(value) == 1 ? RAID_1 : atoi(value) == 5 ? RAID_5 : RAID_0;
+            ok = strcmp(value, "0") == 0 || strcmp(value, "1") == 0 || strcmp(value, "5") == 0;
+        } else if (ok && strcmp(argv[i], "--strategy") == 0) {
+            ok = (num_strategies = parse_strategies(value, strategies)) > 0;
+        } else if (ok && strcmp(argv[i], "--window") == 0) {
+            ok = (window = atoi(value)) > 0 && window <= (1 << 24);
+        } else if (ok && strcmp(argv[i], "--merge") == 0) {
+            ok = (drive.merge_sectors = atoi(value)) >= 0;
+        } else if (ok && strcmp(argv[i], "--cache") == 0) {
+            ok = sscanf(value, "%dx%d", &drive.cache_segments, &drive.segment_sectors) >= 1 &&
+                 drive.cache_segments >= 0 && drive.segment_sectors > 0;
+        } else if (ok && strcmp(argv[i], "--policy") == 0) {
+            drive.policy = strcasecmp(value, "slru") == 0 ? CACHE_SLRU : CACHE_LRU;
+            ok = drive.policy == CACHE_SLRU || strcasecmp(value, "lru") == 0;
+        } else if (ok && strcmp(argv[i], "--write-back") == 0) {
+            drive.write_back = atoi(value);
+            ok = strcmp(value, "0") == 0 || strcmp(value, "1") == 0;
+        } else {
+            ok = 0;
+        }
+    }
+    if (ok && level == RAID_5 && disks < 3) ok = 0;
+    // Стандартный ввод не перемотать, по нему проходит одна стратегия
+    if (ok && num_strategies > 1 && strcmp(argv[0], "-") == 0) ok = 0;
+    if (!ok) {
+        trace_usage();
+        return 1;
+    }
+
+    printf("Трасса %s: %s из %d дисков, окно %d запросов\n", argv[0], raid_names[level], disks,
+           ring_capacity(window));
+    print_drive_config(&drive);
+    printf("\n%-21s %20s %17s %10s %10s %14s %17s %21s %20s %17s %20s\n", "Стратегия", "Запросов", "Среднее",
+           "p50", "p99", "Макс", "Очередь", "Запросов/с", "Событий/с", "Слияний", "Попаданий");
+
+    for (int k = 0; k < num_strategies; k++) {
+        TraceSource trace;
+        if (!trace_open(&trace, argv[0])) {
+            printf("Не удалось открыть трассу %s\n", argv[0]);
+            return 1;
+        }
+        ArrayConfig config = {level, disks, &schedulers[strategies[k]], drive};
+        SimulationStats stats = {0};
+        long long events;
+        double t0 = wall_ms();
+        simulate_source(&config, &trace.source, window, &stats, &events);
+        double elapsed = wall_ms() - t0;
+        printf("%-12s %12d %10.2f %10.2f %10.2f %10.2f %10d %12.1f %12.0f %10d %10d\n",
+               schedulers[strategies[k]].name, stats.total_requests, stats.avg_time, stats.p50_time,
+               stats.p99_time, stats.max_time, stats.max_queue_length, stats.throughput,
+               elapsed > 0 ? events / (elapsed / 1000.0) : 0, stats.merged_requests, stats.cache_hits);
+        if (k == num_strategies - 1)
+            printf("\nСтрок: %lld, пропущено: %lld\n", trace.lines, trace.skipped);
+        trace_close(&trace);
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("Пиковая память: %ld КБ\n", usage.ru_maxrss);
+    return 0;
+}
+
+// --- Нагрузка ---
+// Открытые источники выдают запросы независимо от обслуживания: пуассоновский
+// поток с заданной интенсивностью и MMPP — пуассоновский поток, интенсивность
+// которого переключается между спокойным и пиковым (в MMPP_BURST раз выше)
+// состояниями через экспоненциальные промежутки. Средняя интенсивность
+// обоих одинакова. Замкнутый источник — clients клиентов, у каждого depth
+// запросов в работе: завершив запрос, клиент выжидает экспоненциальную
+// паузу со средним think и выдаёт следующий. Запросы выдаются до horizon мс.
+#define MMPP_BURST 4.0
+#define MMPP_CALM_MS 1000.0    // среднее время в спокойном состоянии
+#define MMPP_PEAK_MS 250.0     // среднее время в пиковом состоянии
+
+typedef enum {
+    LOAD_POISSON,
+    LOAD_MMPP,
+    LOAD_CLOSED
+} LoadModel;
+
+static const char* load_model_names[] = {"poisson", "mmpp", "closed"};
+
+static double rng_exponential(Rng* rng, double mean) {
+    return -log(1.0 - rng_uniform(rng)) * mean;
+}
+
+typedef struct {
+    RequestSource source;
+    Rng rng;
+    int n;
+    double rate;              // запросов в мс, в среднем
+    double horizon;
+    double time;
+    int bursty;
+    int peak;
+    double switch_time;
+    int issued;
+} OpenSource;
+
+static int open_next(RequestSource* source, DiskRequest* out) {
+    OpenSource* s = (OpenSource*)source;
+    for (;;) {
+        double rate = s->rate;
+        if (s->bursty) {
+            // Доля времени в пике p = PEAK / (CALM + PEAK), средняя
+            // интенсивность calm * (1 - p + p * BURST) равна rate
+            double p = MMPP_PEAK_MS / (MMPP_CALM_MS + MMPP_PEAK_MS);
+            rate = rate / (1 - p + p * MMPP_BURST) * (s->peak ? MMPP_BURST : 1);
+        }
+        double t = s->time + rng_exponential(&s->rng, 1.0 / rate);
+        if (s->bursty && t >= s->switch_time) {
+            // Поток без памяти: после переключения интервал разыгрывается заново
+            s->time = s->switch_time;
+            s->peak = !s->peak;
+            s->switch_time += rng_exponential(&s->rng, s->peak ? MMPP_PEAK_MS : MMPP_CALM_MS);
+            continue;
+        }
+        s->time = t;
+        break;
+    }
+    if (s->time >= s->horizon) return 0;
+    random_request(&s->rng, s->n, s->time, out);
+    s->issued++;
+    return 1;
+}
+
+static void open_init(OpenSource* s, int bursty, double rate_per_s, int n, double horizon, uint64_t seed) {
+    memset(s, 0, sizeof(*s));
+    s->source.next = open_next;
+    s->rng = rng_make(seed, bursty);
+    s->n = n;
+    s->rate = rate_per_s / 1000.0;
+    s->horizon = horizon;
+    s->bursty = bursty;
+    s->switch_time = bursty ? rng_exponential(&s->rng, MMPP_CALM_MS) : 0;
+}
+
+// Каждый из clients * depth жетонов по очереди выжидает паузу и держит один
+// запрос в работе. Готовые к выдаче жетоны лежат в куче по времени выдачи.
+typedef struct {
+    RequestSource source;
+    Rng rng;
+    int n;
+    double think;
+    double horizon;
+    EventHeap ready;          // disk — номер жетона
+    DiskRequest* pending;     // запрос, который жетон выдаст
+    int* owner;               // жетон выданного запроса, по номеру & mask,
+                              // кольцо того же размера, что у движка
+    int mask;
+    int issued;
+    int last;                 // жетон последнего выданного запроса
+} ClosedSource;
+
+static void closed_schedule(ClosedSource* s, int token, double now) {
+    double time = now + rng_exponential(&s->rng, s->think);
+    if (time >= s->horizon) return;
+    random_request(&s->rng, s->n, time, &s->pending[token]);
+    event_push(&s->ready, time, 0, token, -1);
+}
+
+static int closed_next(RequestSource* source, DiskRequest* out) {
+    ClosedSource* s = (ClosedSource*)source;
+    if (s->ready.count == 0) return 0;
+    s->last = event_pop(&s->ready).disk;
+    s->owner[s->issued++ & s->mask] = s->last;
+    *out = s->pending[s->last];
+    return 1;
+}
+
+static void closed_unread(RequestSource* source, const DiskRequest* request) {
+    ClosedSource* s = (ClosedSource*)source;
+    s->issued--;
+    event_push(&s->ready, request->arrival_time, 0, s->last, -1);
+}
+
+static void closed_complete(RequestSource* source, int logical, double now) {
+    ClosedSource* s = (ClosedSource*)source;
+    closed_schedule(s, s->owner[logical & s->mask], now);
+}
+
+static void closed_init(ClosedSource* s, int tokens, int window, double think, int n, double horizon,
+                        uint64_t seed) {
+    memset(s, 0, sizeof(*s));
+    s->source = (RequestSource){closed_next, closed_complete, closed_unread};
+    s->rng = rng_make(seed, 2);
+    s->n = n;
+    s->think = think;
+    s->horizon = horizon;
+    s->pending = malloc(tokens * sizeof(DiskRequest));
+    // simulate_source округляет окно до ring_capacity(window); движок не
+    // принимает номер, пока не завершён номер на окно раньше, и ещё один
+    // запрос держит выданным наперёд. Живых номеров не больше окна плюс
+    // один подряд, и в кольце такого размера их ячейки не совпадают. По
+    // числу жетонов кольцо брать нельзя — SSTF и SATF обгоняют голодающий
+    // запрос, и его ячейку занимает более поздний номер.
+    s->mask = ring_capacity(ring_capacity(window) + 1) - 1;
+    s->owner = malloc((s->mask + 1) * sizeof(int));
+    for (int token = 0; token < tokens; token++) closed_schedule(s, token, 0);
+}
+
+static void closed_free(ClosedSource* s) {
+    free(s->ready.items);
+    free(s->pending);
+    free(s->owner);
+}
+
+static void load_usage() {
+    printf("Использование: ./2 load [--model poisson|mmpp|closed] [--load 5,10,20,...] [--strategy all|FIFO,...]\n");
+    printf("                        [--depth 1] [--think 10] [--n 16] [--time 60000] [--window 128] [--seed 1]\n");
+}
+
+// Кривая пропускная способность — задержка: для открытой нагрузки --load
+// задаёт интенсивность в запросах/с, для замкнутой — число клиентов.
+// Насыщение открытой системы — первая нагрузка, которую она перестаёт
+// пропускать (меньше 95% поданной), замкнутой — первое удвоение клиентов,
+// добавившее меньше 5% пропускной способности.
+int run_load(int argc, char* argv[]) {
+    LoadModel model = LOAD_POISSON;
+    double loads[SWEEP_MAX_VALUES] = {5, 10, 20, 40, 60, 80, 100, 120, 160};
+    int num_loads = 9;
+    int strategies[NUM_SCHEDULERS];
+    int num_strategies = parse_strategies("all", strategies);
+    int depth = 1, n = 16, window = 128;
+    double think = 10, horizon = 60000;
+    uint64_t seed = 1;
+    int custom_loads = 0;
+
+    for (int i = 0; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        int ok = value != NULL;
+        if (ok && strcmp(argv[i], "--model") == 0) {
+            ok = 0;
+            for (int m = LOAD_POISSON; m <= LOAD_CLOSED; m++)
+                if (strcasecmp(value, load_model_names[m]) == 0) {
+                    model = m;
+                    ok = 1;
+                }
+        } else if (ok && strcmp(argv[i], "--load") == 0) {
+            ok = (num_loads = parse_doubles(value, loads)) > 0;
+            custom_loads = 1;
+        } else if (ok && strcmp(argv[i], "--strategy") == 0) {
+            ok = (num_strategies = parse_strategies(value, strategies)) > 0;
+        } else if (ok && strcmp(argv[i], "--depth") == 0) {
+            ok = (depth = atoi(value)) > 0;
+        } else if (ok && strcmp(argv[i], "--think") == 0) {
+            ok = (think = atof(value)) >= 0;
+        } else if (ok && strcmp(argv[i], "--n") == 0) {
+            ok = (n = atoi(value)) > 0;
+        } else if (ok && strcmp(argv[i], "--time") == 0) {
+            ok = (horizon = atof(value)) > 0;
+        } else if (ok && strcmp(argv[i], "--window") == 0) {
+            ok = (window = atoi(value)) > 0 && window <= (1 << 24);
+        } else if (ok && strcmp(argv[i], "--seed") == 0) {
+            seed = strtoull(value, NULL, 10);
+        } else {
+            ok = 0;
+        }
+        if (!ok) {
+            printf("Неверный параметр: %s %s\n", argv[i], value ? value : "");
+            load_usage();
+            return 1;
+        }
+        i++;
+    }
+    if (model == LOAD_CLOSED && !custom_loads) {
+        double clients[] = {1, 2, 4, 8, 16, 32, 64};
+        num_loads = sizeof(clients) / sizeof(clients[0]);
+        memcpy(loads, clients, sizeof(clients));
+    }
+
+    printf("Нагрузка %s, %.0f мс, n = %d", load_model_names[model], horizon, n);
+    if (model == LOAD_CLOSED) printf(", глубина %d, пауза %.1f мс", depth, think);
+    // Ширины полей в байтах: кириллица в UTF-8 занимает по два
+    if (model == LOAD_CLOSED)
+        printf("\n%-21s %18s", "Стратегия", "Клиентов");
+    else
+        printf("\n%-21s %17s", "Стратегия", "Подано/с");
+    printf(" %21s %17s %10s %10s\n", "Запросов/с", "Среднее", "p99", "p99.9");
+
+    for (int k = 0; k < num_strategies; k++) {
+        const Scheduler* scheduler = &schedulers[strategies[k]];
+        double previous = 0, saturation = 0;
+        for (int l = 0; l < num_loads; l++) {
+            ArrayConfig config = {RAID_0, 1, scheduler};
+            SimulationStats stats = {0};
+            if (model == LOAD_CLOSED) {
+                ClosedSource source;
+                int tokens = (int)loads[l] * depth, closed_window = tokens > window ? tokens : window;
+                closed_init(&source, tokens, closed_window, think, n, horizon, seed);
+                simulate_source(&config, &source.source, closed_window, &stats, NULL);
+                closed_free(&source);
+                if (!saturation && l > 0 && stats.throughput < previous * 1.05) saturation = loads[l - 1];
+            } else {
+                OpenSource source;
+                open_init(&source, model == LOAD_MMPP, loads[l], n, horizon, seed);
+                simulate_source(&config, &source.source, window, &stats, NULL);
+                // Сравнение с фактически поданным потоком, а не с номиналом,
+                // чтобы разброс одной реализации не выглядел насыщением
+                double offered = source.issued / (horizon / 1000.0);
+                if (!saturation && stats.throughput < offered * 0.95) saturation = loads[l];
+            }
+            previous = stats.throughput;
+            printf("%-12s %10g %12.1f %10.2f %10.2f %10.2f\n", scheduler->name, loads[l], stats.throughput,
+                   stats.avg_time, stats.p99_time, stats.p999_time);
+        }
+        if (!saturation)
+            printf("  %s: насыщение не достигнуто\n", scheduler->name);
+        else if (model == LOAD_CLOSED)
+            printf("  %s: насыщение при %g клиентах\n", scheduler->name, saturation);
+        else
+            printf("  %s: насыщение при подаче %g запросов/с\n", scheduler->name, saturation);
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "sweep") == 0)
+        return run_sweep(argc - 2, argv + 2);
+    if (argc > 1 && strcmp(argv[1], "raid") == 0)
+        return run_raid(argc - 2, argv + 2);
+    if (argc > 1 && strcmp(argv[1], "bench-satf") == 0)
+        return run_bench_satf(argc - 2, argv + 2);
+    if (argc > 1 && strcmp(argv[1], "cache") == 0)
+        return run_cache(argc - 2, argv + 2);
+    if (argc > 1 && strcmp(argv[1], "load") == 0)
+        return run_load(argc - 2, argv + 2);
+    if (argc > 1 && strcmp(argv[1], "trace") == 0)
+        return run_trace(argc - 2, argv + 2);
+
     const char* strategy = "SSTF";
     double t_max = 2.0;
     int n = 16;
+    uint64_t seed = argc > 1 ? strtoull(argv[1], NULL, 10) : (uint64_t)time(NULL);
 
     double t_max_values[] = {t_max, t_max/10, t_max/100};
     int num_experiments = 3;
@@ -335,7 +2368,8 @@ int main() {
     printf("- Время моделирования: %.0f мс\n", SIMULATION_TIME);
     printf("- Стратегия сравнения: %s\n", strategy);
     printf("- Параметр t_max: %.1f с\n", t_max);
-    printf("- Параметр n: %d\n\n", n);
+    printf("- Параметр n: %d\n", n);
+    printf("- Зерно генератора: %llu\n\n", (unsigned long long)seed);
 
     for (int exp = 0; exp < num_experiments; exp++) {
         double current_t_max = t_max_values[exp];
@@ -343,40 +2377,41 @@ int main() {
         printf("----------------------------------------\n");
 
         int total_requests;
-        DiskRequest* requests = generate_requests(current_t_max, n, &total_requests);
+        DiskRequest* requests = generate_requests(current_t_max, n, seed, &total_requests);
         printf("Сгенерировано запросов: %d\n", total_requests);
 
-        SimulationStats stats_fifo = {0};
-        DiskRequest* fifo_copy = malloc(total_requests * sizeof(DiskRequest));
-        memcpy(fifo_copy, requests, total_requests * sizeof(DiskRequest));
-        simulate_fifo(fifo_copy, total_requests, &stats_fifo);
-
-        SimulationStats stats_sstf = {0};
-        DiskRequest* sstf_copy = malloc(total_requests * sizeof(DiskRequest));
-        memcpy(sstf_copy, requests, total_requests * sizeof(DiskRequest));
-        simulate_sstf(sstf_copy, total_requests, &stats_sstf);
-
-        printf("\nРезультаты FIFO:\n");
-        printf("Среднее: %.2f | Макс: %.2f | Мин: %.2f | Std: %.2f | Очередь макс: %d\n",
-               stats_fifo.avg_time, stats_fifo.max_time, stats_fifo.min_time,
-               stats_fifo.std_dev, stats_fifo.max_queue_length);
-        printf("Простой: %.2f мс | Запросов: %d\n",
-               stats_fifo.total_idle_time, stats_fifo.total_requests);
-
-        printf("\nРезультаты SSTF:\n");
-        printf("Среднее: %.2f | Макс: %.2f | Мин: %.2f | Std: %.2f | Очередь макс: %d\n",
-               stats_sstf.avg_time, stats_sstf.max_time, stats_sstf.min_time,
-               stats_sstf.std_dev, stats_sstf.max_queue_length);
-        printf("Простой: %.2f мс | Запросов: %d\n",
-               stats_sstf.total_idle_time, stats_sstf.total_requests);
+        SimulationStats stats[NUM_SCHEDULERS];
+        DiskRequest* copies[NUM_SCHEDULERS];
+        for (int k = 0; k < NUM_SCHEDULERS; k++) {
+            memset(&stats[k], 0, sizeof(stats[k]));
+            copies[k] = malloc(total_requests * sizeof(DiskRequest));
+            memcpy(copies[k], requests, total_requests * sizeof(DiskRequest));
+            simulate(&schedulers[k], copies[k], total_requests, &stats[k]);
+        }
+
+        // Подробные результаты для FIFO и SSTF
+        for (int k = 0; k < 2; k++) {
+            printf("\nРезультаты %s:\n", schedulers[k].name);
+            printf("Среднее: %.2f | Макс: %.2f | Мин: %.2f | Std: %.2f | Очередь макс: %d\n",
+                   stats[k].avg_time, stats[k].max_time, stats[k].min_time,
+                   stats[k].std_dev, stats[k].max_queue_length);
+            printf("Простой: %.2f мс | Запросов: %d\n",
+                   stats[k].total_idle_time, stats[k].total_requests);
+        }
+
+        printf("\nСравнение стратегий:\n");
+        // Ширины полей в байтах: кириллица в UTF-8 занимает два байта на букву
+        printf("%-21s %13s %10s %14s %21s %15s\n", "Стратегия", "Среднее", "p99", "Макс", "Запросов/с", "Очередь");
+        for (int k = 0; k < NUM_SCHEDULERS; k++)
+            printf("%-12s %10.2f %10.2f %10.2f %12.1f %8d\n", schedulers[k].name, stats[k].avg_time,
+                   stats[k].p99_time, stats[k].max_time, stats[k].throughput, stats[k].max_queue_length);
 
         printf("\n=== Гистограммы для эксперимента %d (t_max = %.3f с) ===\n", exp + 1, current_t_max);
-        create_histogram(fifo_copy, total_requests, "FIFO");
-        create_histogram(sstf_copy, total_requests, "SSTF");
+        create_histogram(&stats[0].latency, "FIFO");
+        create_histogram(&stats[1].latency, "SSTF");
 
         free(requests);
-        free(fifo_copy);
-        free(sstf_copy);
+        for (int k = 0; k < NUM_SCHEDULERS; k++) free(copies[k]);
         printf("\n");
     }
 
@@ -1,15 +1,171 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <math.h>
+#include <float.h>
+#include <string.h>
 #include <mpi.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+#define LANES 4
+#define TRIG_VECTOR_LIMIT 1e6  // дальше приведение по 3 частям pi/2 теряет точность
+#define BLOCK_POINTS 4096      // точек на одну порцию потока
+
 static inline double f(double x) {
     return sin(x);
 }
 
+#if defined(__GNUC__)
+typedef double Lanes __attribute__((vector_size(LANES * sizeof(double))));
+typedef long long LaneMask __attribute__((vector_size(LANES * sizeof(double))));
+
+// sin(x + quadrant * pi/2) по LANES точкам: x = k*pi/2 + r, |r| <= pi/4,
+// приведение Коди-Уэйта и многочлены ядра fdlibm для sin и cos на r,
+// ошибка не больше 2 ulp при |x| < TRIG_VECTOR_LIMIT.
+static inline void trig_lanes(const Lanes *x, Lanes *y, int quadrant) {
+    // Округление до целого сдвигом на 1.5 * 2^52
+    Lanes k = (*x * (2.0 / M_PI) + 0x1.8p52) - 0x1.8p52;
+    Lanes r = ((*x - k * 1.57079625129699707031e+00) - k * 7.54978941586159635335e-08) - k * 5.39030285815811905290e-15;
+    Lanes z = r * r;
+    Lanes s = r + r * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03 +
+              z * (-1.98412698298579493134e-04 + z * (2.75573137070700676789e-06 +
+              z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)))));
+    Lanes c = 1.0 - 0.5 * z + z * z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03 +
+              z * (2.48015872894767294178e-05 + z * (-2.75573143513906633035e-07 +
+              z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11)))));
+    // Четверть (k + quadrant) & 3: sin, cos, -sin, -cos
+    LaneMask q = ((LaneMask)(k + 0x1.8p52) + quadrant) & 3;
+    LaneMask odd = -(q & 1);
+    LaneMask res = ((LaneMask)c & odd) | ((LaneMask)s & ~odd);
+    *y = (Lanes)(res ^ ((q & 2) << 62));
+}
+#endif
+
+// --- Подынтегральные функции ---
+// kernel выбирает векторное ядро для LANES точек сразу при |x| < limit.
+// Ядра встраиваются в цикл суммы, а не вызываются по указателю: косвенный
+// вызов на каждые LANES точек стоил трети ускорения sin. Без векторных
+// расширений GCC считается цикл по f.
+enum {
+    KERNEL_NONE,
+    KERNEL_SIN,
+    KERNEL_COS,
+    KERNEL_RUNGE
+};
+
+static double runge(double x) {
+    return 1.0 / (1.0 + 25.0 * x * x);
+}
+
+static double gauss(double x) {
+    return exp(-x * x);
+}
+
+static double sin_primitive(double x) {
+    return -cos(x);
+}
+
+static double runge_primitive(double x) {
+    return atan(5.0 * x) / 5.0;
+}
+
+static double gauss_primitive(double x) {
+    return sqrt(M_PI) / 2.0 * erf(x);
+}
+
+static double sqrt_primitive(double x) {
+    return 2.0 / 3.0 * x * sqrt(x);
+}
+
+typedef struct {
+    const char *name;
+    double (*f)(double);
+    int kernel;                                 // KERNEL_NONE — только f
+    double limit;
+    double (*primitive)(double);                // для точного значения
+} Integrand;
+
+static const Integrand integrands[] = {
+    {"sin", sin, KERNEL_SIN, TRIG_VECTOR_LIMIT, sin_primitive},
+    {"cos", cos, KERNEL_COS, TRIG_VECTOR_LIMIT, sin},
+    {"runge", runge, KERNEL_RUNGE, HUGE_VAL, runge_primitive},
+    {"exp", exp, KERNEL_NONE, 0.0, exp},
+    {"gauss", gauss, KERNEL_NONE, 0.0, gauss_primitive},
+    {"sqrt", sqrt, KERNEL_NONE, 0.0, sqrt_primitive},
+};
+#define NUM_INTEGRANDS (int)(sizeof(integrands) / sizeof(integrands[0]))
+
+static const Integrand *find_integrand(const char *name) {
+    for (int k = 0; k < NUM_INTEGRANDS; ++k)
+        if (strcmp(integrands[k].name, name) == 0) return &integrands[k];
+    return NULL;
+}
+
+#if defined(__GNUC__)
+// Векторная часть суммы по [*i, end) для ядра kernel; *i сдвигается до
+// хвоста короче LANES. kernel — константа в каждом вызове, и после
+// встраивания выбор ядра уходит из цикла.
+static inline __attribute__((always_inline)) double sum_lanes(int kernel, double a, double h, long long *i,
+                                                             long long end) {
+    const Lanes offset = {0.0, 1.0, 2.0, 3.0};
+    Lanes part = {0.0}, y;
+    long long k = *i;
+    for (; k + LANES <= end; k += LANES) {
+        Lanes x = a + ((double)k + offset) * h;
+        if (kernel == KERNEL_RUNGE)
+            y = 1.0 / (1.0 + 25.0 * x * x);
+        else
+            trig_lanes(&x, &y, kernel == KERNEL_COS);
+        part += y;
+    }
+    *i = k;
+    double sum = 0.0;
+    for (int j = 0; j < LANES; ++j) sum += part[j];
+    return sum;
+}
+#endif
+
+// Сумма fn(a + i*h) по i из [i, end). Точки линейны по i, так что для
+// векторного пути достаточно проверить концы.
+static double sum_block(const Integrand *fn, double a, double h, long long i, long long end) {
+    double sum = 0.0;
+#if defined(__GNUC__)
+    if (fn->kernel != KERNEL_NONE && fabs(a + i * h) < fn->limit && fabs(a + (end - 1) * h) < fn->limit) {
+        switch (fn->kernel) {
+        case KERNEL_SIN:
+            sum = sum_lanes(KERNEL_SIN, a, h, &i, end);
+            break;
+        case KERNEL_COS:
+            sum = sum_lanes(KERNEL_COS, a, h, &i, end);
+            break;
+        case KERNEL_RUNGE:
+            sum = sum_lanes(KERNEL_RUNGE, a, h, &i, end);
+            break;
+        }
+    }
+#endif
+    for (; i < end; ++i) sum += fn->f(a + i * h);
+    return sum;
+}
+
+// Сумма fn(a + i*h) по i из [first, last): каждая точка считается один раз,
+// порции по BLOCK_POINTS делят потоки OpenMP.
+static double sum_points(const Integrand *fn, double a, double h, long long first, long long last) {
+    long long blocks = (last - first + BLOCK_POINTS - 1) / BLOCK_POINTS;
+    double sum = 0.0;
+    #pragma omp parallel for schedule(static) reduction(+:sum)
+    for (long long blk = 0; blk < blocks; ++blk) {
+        long long i = first + blk * BLOCK_POINTS;
+        sum += sum_block(fn, a, h, i, i + BLOCK_POINTS < last ? i + BLOCK_POINTS : last);
+    }
+    return sum;
+}
+
 static inline void split_work(long long n, int size, int rank, long long *start, long long *count) {
     long long base = n / size;
     long long r = n % size;
@@ -22,13 +178,818 @@ static inline void split_work(long long n, int size, int rank, long long *start,
     }
 }
 
-int main(int argc, char *argv[]) {
-    MPI_Init(&argc, &argv);
+// --- Адаптивный режим ---
+// Гаусс-Кронрод по 15 точкам: оценка ошибки |K15 - G7|. Интервал принимается,
+// если его ошибка не больше tol, умноженного на его долю в [a, b], или не
+// больше ADAPT_ROUNDOFF * |K15| (как в QUADPACK): меньше double уже не
+// различает. Иначе он делится пополам. Ранг 0 держит очередь интервалов и
+// раздаёт их пачками свободным рангам; у каждого в работе до ADAPT_AHEAD
+// пачек, чтобы следующая приходила, пока считается текущая. Очередь — куча
+// по ошибке родителя: первыми делятся интервалы с наибольшей ошибкой, и если
+// упереться в ADAPT_LIMIT, без деления остаются самые точные.
+#define ADAPT_BATCH 64           // интервалов в пачке
+#define ADAPT_AHEAD 2            // пачек в работе у ранга
+#define ADAPT_START 16           // начальных интервалов на ранг
+#define ADAPT_LIMIT (1LL << 22)  // интервалов всего; дальше не делятся
+#define ADAPT_ROUNDOFF (50.0 * DBL_EPSILON)
+#define TAG_WORK 1
+#define TAG_RESULT 2
+
+static const double gk_nodes[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.000000000000000000000000000000000};
+static const double gk_weights[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+static const double gauss_weights[4] = {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+
+// Интеграл fn по [a, b] и оценка его ошибки
+static void gauss_kronrod(const Integrand *fn, double a, double b, double *integral, double *error) {
+    double center = 0.5 * (a + b), half = 0.5 * (b - a);
+    double fc = fn->f(center);
+    double kronrod = fc * gk_weights[7], gauss = fc * gauss_weights[3];
+    for (int j = 0; j < 7; ++j) {
+        double sum = fn->f(center - half * gk_nodes[j]) + fn->f(center + half * gk_nodes[j]);
+        kronrod += gk_weights[j] * sum;
+        if (j % 2 == 1) gauss += gauss_weights[j / 2] * sum;
+    }
+    *integral = kronrod * half;
+    *error = fabs((kronrod - gauss) * half);
+}
+
+// Пачка: пары (a, b) на входе, четвёрки (a, b, интеграл, ошибка) на выходе
+static void adapt_batch(const Integrand *fn, const double *work, int count, double *result) {
+    for (int k = 0; k < count; ++k) {
+        result[4 * k] = work[2 * k];
+        result[4 * k + 1] = work[2 * k + 1];
+        gauss_kronrod(fn, work[2 * k], work[2 * k + 1], &result[4 * k + 2], &result[4 * k + 3]);
+    }
+}
+
+typedef struct {
+    double a, b, error;          // error — оценка родителя
+} Interval;
+
+typedef struct {
+    Interval *items;             // куча: ошибка родителя не меньше, чем у детей
+    long long count, capacity;
+} IntervalHeap;
+
+static void heap_push(IntervalHeap *h, double a, double b, double error) {
+    if (h->count == h->capacity) {
+        h->capacity = h->capacity ? h->capacity * 2 : 1024;
+        h->items = realloc(h->items, h->capacity * sizeof(Interval));
+        if (!h->items) MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    long long k = h->count++;
+    while (k > 0 && h->items[(k - 1) / 2].error < error) {
+        h->items[k] = h->items[(k - 1) / 2];
+        k = (k - 1) / 2;
+    }
+    h->items[k] = (Interval){a, b, error};
+}
+
+// Снимает count интервалов с наибольшей ошибкой парами (a, b) в work
+static void heap_pop(IntervalHeap *h, int count, double *work) {
+    for (int n = 0; n < count; ++n) {
+        work[2 * n] = h->items[0].a;
+        work[2 * n + 1] = h->items[0].b;
+        Interval last = h->items[--h->count];
+        long long k = 0;
+        for (;;) {
+            long long child = 2 * k + 1;
+            if (child >= h->count) break;
+            if (child + 1 < h->count && h->items[child + 1].error > h->items[child].error) child++;
+            if (h->items[child].error <= last.error) break;
+            h->items[k] = h->items[child];
+            k = child;
+        }
+        if (h->count > 0) h->items[k] = last;
+    }
+}
+
+typedef struct {
+    double integral, error;
+    long long intervals;         // оценённых интервалов
+    long long unresolved;        // принятых из-за ADAPT_LIMIT или точности double
+} AdaptResult;
+
+// Принимает или делит оценённые интервалы пачки
+static void adapt_collect(const double *result, int count, double a, double b, double tol,
+                          IntervalHeap *heap, AdaptResult *out) {
+    for (int k = 0; k < count; ++k) {
+        double lo = result[4 * k], hi = result[4 * k + 1], mid = 0.5 * (lo + hi);
+        double integral = result[4 * k + 2], error = result[4 * k + 3];
+        out->intervals++;
+        int limit = mid == lo || mid == hi || error <= ADAPT_ROUNDOFF * fabs(integral) ||
+                    out->intervals + heap->count >= ADAPT_LIMIT;
+        if (error <= tol * fabs((hi - lo) / (b - a)) || limit) {
+            if (error > tol * fabs((hi - lo) / (b - a))) out->unresolved++;
+            out->integral += integral;
+            out->error += error;
+        } else {
+            heap_push(heap, lo, mid, error);
+            heap_push(heap, mid, hi, error);
+        }
+    }
+}
+
+static void adapt_master(const Integrand *fn, double a, double b, double tol, int size, AdaptResult *out) {
+    IntervalHeap heap = {0};
+    int workers = size - 1, pieces = ADAPT_START * (workers > 0 ? workers : 1);
+    for (int k = 0; k < pieces; ++k)
+        heap_push(&heap, a + (b - a) * k / pieces, k + 1 == pieces ? b : a + (b - a) * (k + 1) / pieces, HUGE_VAL);
+
+    double work[2 * ADAPT_BATCH];
+    double *result = malloc((size_t)(workers > 0 ? workers : 1) * 4 * ADAPT_BATCH * sizeof(double));
+    if (workers < 1) {
+        while (heap.count > 0) {
+            int count = heap.count < ADAPT_BATCH ? (int)heap.count : ADAPT_BATCH;
+            heap_pop(&heap, count, work);
+            adapt_batch(fn, work, count, result);
+            adapt_collect(result, count, a, b, tol, &heap, out);
+        }
+        free(result);
+        free(heap.items);
+        return;
+    }
+
+    MPI_Request *requests = malloc(workers * sizeof(MPI_Request));
+    int *in_flight = calloc(workers, sizeof(int));
+    int busy = 0;
+    for (int w = 0; w < workers; ++w)
+        MPI_Irecv(result + 4 * ADAPT_BATCH * w, 4 * ADAPT_BATCH, MPI_DOUBLE, w + 1, TAG_RESULT,
+                  MPI_COMM_WORLD, &requests[w]);
+    for (;;) {
+        // Пачки делятся поровну, пока очередь короче, чем нужно всем рангам
+        for (int round = 0; round < ADAPT_AHEAD && heap.count > 0; ++round) {
+            for (int w = 0; w < workers && heap.count > 0; ++w) {
+                if (in_flight[w] >= ADAPT_AHEAD) continue;
+                long long share = (heap.count + workers - 1) / workers;
+                int count = share < ADAPT_BATCH ? (int)share : ADAPT_BATCH;
+                heap_pop(&heap, count, work);
+                MPI_Send(work, 2 * count, MPI_DOUBLE, w + 1, TAG_WORK, MPI_COMM_WORLD);
+                in_flight[w]++;
+                busy++;
+            }
+        }
+        if (busy == 0) break;
+
+        int w, count;
+        MPI_Status status;
+        MPI_Waitany(workers, requests, &w, &status);
+        MPI_Get_count(&status, MPI_DOUBLE, &count);
+        adapt_collect(result + 4 * ADAPT_BATCH * w, count / 4, a, b, tol, &heap, out);
+        in_flight[w]--;
+        busy--;
+        MPI_Irecv(result + 4 * ADAPT_BATCH * w, 4 * ADAPT_BATCH, MPI_DOUBLE, w + 1, TAG_RESULT,
+                  MPI_COMM_WORLD, &requests[w]);
+    }
+    // Пустая пачка — конец работы
+    for (int w = 0; w < workers; ++w) {
+        MPI_Cancel(&requests[w]);
+        MPI_Wait(&requests[w], MPI_STATUS_IGNORE);
+        MPI_Send(NULL, 0, MPI_DOUBLE, w + 1, TAG_WORK, MPI_COMM_WORLD);
+    }
+    free(requests);
+    free(in_flight);
+    free(result);
+    free(heap.items);
+}
+
+static void adapt_worker(const Integrand *fn) {
+    double work[2][2 * ADAPT_BATCH], result[4 * ADAPT_BATCH];
+    MPI_Status status;
+    MPI_Request next;
+    int cur = 0, count;
+    MPI_Recv(work[cur], 2 * ADAPT_BATCH, MPI_DOUBLE, 0, TAG_WORK, MPI_COMM_WORLD, &status);
+    MPI_Get_count(&status, MPI_DOUBLE, &count);
+    while (count > 0) {
+        // Следующая пачка принимается, пока считается текущая
+        MPI_Irecv(work[!cur], 2 * ADAPT_BATCH, MPI_DOUBLE, 0, TAG_WORK, MPI_COMM_WORLD, &next);
+        adapt_batch(fn, work[cur], count / 2, result);
+        MPI_Send(result, 2 * count, MPI_DOUBLE, 0, TAG_RESULT, MPI_COMM_WORLD);
+        MPI_Wait(&next, &status);
+        MPI_Get_count(&status, MPI_DOUBLE, &count);
+        cur = !cur;
+    }
+}
+
+// ./3 adapt [f] [a b tol]: f из integrands, по умолчанию sin. Все ранги
+// разбирают одни и те же аргументы и одинаково выбирают функцию.
+static int run_adapt(int argc, char *argv[], int rank, int size) {
+    double a = 0.0, b = M_PI, tol = 1e-10;
+    const Integrand *fn = &integrands[0];
+    if (argc == 1 || argc == 4) {
+        fn = find_integrand(argv[0]);
+        argc--;
+        argv++;
+    }
+    if (!fn || (argc != 0 && argc != 3)) {
+        if (rank == 0) {
+            printf("usage: mpirun -np P ./3 adapt [");
+            for (int k = 0; k < NUM_INTEGRANDS; ++k) printf("%s%s", k ? "|" : "", integrands[k].name);
+            printf("] [a b tol]\n");
+        }
+        return 1;
+    }
+    if (argc == 3) {
+        a = atof(argv[0]);
+        b = atof(argv[1]);
+        tol = atof(argv[2]);
+    }
+    double t0 = MPI_Wtime();
+    AdaptResult res = {0};
+    if (rank == 0)
+        adapt_master(fn, a, b, tol, size, &res);
+    else
+        adapt_worker(fn);
+    double t1 = MPI_Wtime();
+
+    if (rank == 0) {
+        double exact = fn->primitive(b) - fn->primitive(a);
+        printf("metod Gaussa-Kronroda (adaptivnyi)\n");
+        printf("integral of %s(x) on [%.7f, %.6f] = %.15f\n", fn->name, a, b, res.integral);
+        printf("exact value: %.15f\n", exact);
+        printf("error: %.15e\n", fabs(res.integral - exact));
+        printf("error estimate: %.15e (tolerance %.3e)\n", res.error, tol);
+        if (res.unresolved > 0)
+            printf("intervals at resolution limit: %lld\n", res.unresolved);
+        printf("number of processes: %d\n", size);
+        printf("number of intervals: %lld\n", res.intervals);
+        printf("function evaluations: %lld\n", 15 * res.intervals);
+        printf("time: %.6f seconds\n", t1 - t0);
+    }
+    return 0;
+}
+
+// --- Ромберг ---
+// Уровень k — трапеции с 2^k интервалами: к сумме прошлого уровня
+// добавляются только новые середины, каждый ранг берёт свою долю и один
+// MPI_Allreduce на уровень собирает сумму. Экстраполяция Ричардсона идёт
+// по строке таблицы; все ранги получают одну сумму и одинаково решают,
+// когда остановиться.
+#define ROMBERG_MIN_LEVEL 5       // раньше совпадение строк бывает случайным
+#define ROMBERG_MAX_LEVEL 30      // 2^30 интервалов, около 10 прогонов трапеций по умолчанию
+
+static void run_romberg(int argc, char *argv[], int rank, int size) {
+    double a = 0.0, b = M_PI, tol = 1e-12;
+    if (argc == 3) {
+        a = atof(argv[0]);
+        b = atof(argv[1]);
+        tol = atof(argv[2]);
+    }
+    double t0 = MPI_Wtime();
+    double prev[ROMBERG_MAX_LEVEL + 1], row[ROMBERG_MAX_LEVEL + 1];
+    double h = b - a, estimate = 0.0;
+    int level = 0;
+    row[0] = h * (f(a) + f(b)) / 2.0;
+    while (level < ROMBERG_MAX_LEVEL) {
+        // Новые точки a + (2i + 1) * h/2, i из [0, 2^level)
+        long long count = 1LL << level, start, local_n;
+        split_work(count, size, rank, &start, &local_n);
+        double local_sum = sum_points(&integrands[0], a + h / 2.0, h, start, start + local_n), sum;
+        MPI_Allreduce(&local_sum, &sum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+        memcpy(prev, row, (level + 1) * sizeof(double));
+        level++;
+        h /= 2.0;
+        row[0] = prev[0] / 2.0 + h * sum;
+        double scale = 1.0;
+        for (int j = 1; j <= level; ++j) {
+            scale *= 4.0;
+            row[j] = row[j - 1] + (row[j - 1] - prev[j - 1]) / (scale - 1.0);
+        }
+        estimate = fabs(row[level] - prev[level - 1]);
+        if (level >= ROMBERG_MIN_LEVEL && estimate <= tol) break;
+    }
+    double t1 = MPI_Wtime();
+
+    if (rank == 0) {
+        double exact = cos(a) - cos(b);
+        printf("metod Romberga\n");
+        printf("integral of sin(x) on [%.7f, %.6f] = %.15f\n", a, b, row[level]);
+        printf("exact value: %.15f\n", exact);
+        printf("error: %.15e\n", fabs(row[level] - exact));
+        printf("error estimate: %.15e (tolerance %.3e)\n", estimate, tol);
+        if (estimate > tol)
+            printf("tolerance not reached at level %d\n", ROMBERG_MAX_LEVEL);
+        printf("number of processes: %d\n", size);
+        printf("levels: %d\n", level);
+        printf("function evaluations: %lld\n", (1LL << level) + 1);
+        printf("time: %.6f seconds\n", t1 - t0);
+    }
+}
+
+// --- Пакетный режим ---
+// Файл заданий: строки "функция a b n", # — комментарий. Ранг 0 читает его
+// и рассылает, каждое задание считается трапециями всеми рангами, как в
+// основном режиме. Результаты BATCH_CHUNK заданий сводятся одним
+// MPI_Ireduce, который идёт, пока считается следующая порция.
+#define BATCH_CHUNK 256
+
+typedef struct {
+    int count;
+    int *fn;                     // номер в integrands
+    double *a, *b;
+    long long *n;
+} JobList;
+
+static void jobs_alloc(JobList *jobs, int count) {
+    jobs->count = count;
+    jobs->fn = malloc(count * sizeof(int) + 1);
+    jobs->a = malloc(count * sizeof(double) + 1);
+    jobs->b = malloc(count * sizeof(double) + 1);
+    jobs->n = malloc(count * sizeof(long long) + 1);
+    if (!jobs->fn || !jobs->a || !jobs->b || !jobs->n) MPI_Abort(MPI_COMM_WORLD, 1);
+}
+
+static void jobs_free(JobList *jobs) {
+    free(jobs->fn);
+    free(jobs->a);
+    free(jobs->b);
+    free(jobs->n);
+}
+
+// -1 при ошибке, сообщение уже выведено
+static int jobs_read(const char *path, JobList *jobs) {
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        perror(path);
+        return -1;
+    }
+    int capacity = 0, line_no = 0;
+    char line[256], name[64];
+    jobs_alloc(jobs, 0);
+    while (fgets(line, sizeof(line), in)) {
+        line_no++;
+        char *p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\0') continue;
+        double a, b;
+        long long n;
+        int fields = sscanf(p, "%63s %lf %lf %lld", name, &a, &b, &n);
+        const Integrand *fn = fields == 4 && n > 0 ? find_integrand(name) : NULL;
+        if (!fn) {
+            if (fields == 4 && n > 0)
+                fprintf(stderr, "%s:%d: unknown integrand %s\n", path, line_no, name);
+            else
+                fprintf(stderr, "%s:%d: expected: name a b n\n", path, line_no);
+            fclose(in);
+            return -1;
+        }
+        if (jobs->count == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            jobs->fn = realloc(jobs->fn, capacity * sizeof(int));
+            jobs->a = realloc(jobs->a, capacity * sizeof(double));
+            jobs->b = realloc(jobs->b, capacity * sizeof(double));
+            jobs->n = realloc(jobs->n, capacity * sizeof(long long));
+            if (!jobs->fn || !jobs->a || !jobs->b || !jobs->n) MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        jobs->fn[jobs->count] = (int)(fn - integrands);
+        jobs->a[jobs->count] = a;
+        jobs->b[jobs->count] = b;
+        jobs->n[jobs->count] = n;
+        jobs->count++;
+    }
+    fclose(in);
+    return jobs->count;
+}
+
+static int run_batch(int argc, char *argv[], int rank, int size) {
+    if (argc != 1) {
+        if (rank == 0) printf("usage: mpirun -np P ./3 batch JOBFILE\n");
+        return 1;
+    }
+    double t0 = MPI_Wtime();
+    JobList jobs = {0};
+    int count = rank == 0 ? jobs_read(argv[0], &jobs) : 0;
+    MPI_Bcast(&count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (count < 0) {
+        jobs_free(&jobs);
+        return 1;
+    }
+    if (rank != 0) jobs_alloc(&jobs, count);
+    MPI_Bcast(jobs.fn, count, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(jobs.a, count, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Bcast(jobs.b, count, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Bcast(jobs.n, count, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+
+    double local[2][BATCH_CHUNK];
+    double *total = rank == 0 ? malloc(count * sizeof(double) + 1) : NULL;
+    MPI_Request pending[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+    for (int first = 0, slot = 0; first < count; first += BATCH_CHUNK, slot = !slot) {
+        int m = count - first < BATCH_CHUNK ? count - first : BATCH_CHUNK;
+        // Буфер свободен, когда сведение двухпорционной давности закончилось
+        MPI_Wait(&pending[slot], MPI_STATUS_IGNORE);
+        for (int k = 0; k < m; ++k) {
+            int job = first + k, done;
+            const Integrand *fn = &integrands[jobs.fn[job]];
+            double a = jobs.a[job], b = jobs.b[job], h = (b - a) / (double)jobs.n[job];
+            long long start, local_n;
+            split_work(jobs.n[job], size, rank, &start, &local_n);
+            double sum = sum_points(fn, a, h, start, start + local_n);
+            if (local_n > 0 && start == 0) sum -= fn->f(a) / 2.0;
+            if (local_n > 0 && start + local_n == jobs.n[job]) sum += fn->f(b) / 2.0;
+            local[slot][k] = sum * h;
+            // Без вызовов MPI сведение прошлой порции может стоять
+            MPI_Test(&pending[!slot], &done, MPI_STATUS_IGNORE);
+        }
+        MPI_Ireduce(local[slot], total ? total + first : NULL, m, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD,
+                    &pending[slot]);
+    }
+    MPI_Waitall(2, pending, MPI_STATUSES_IGNORE);
+    double t1 = MPI_Wtime();
+
+    if (rank == 0) {
+        for (int job = 0; job < count; ++job) {
+            const Integrand *fn = &integrands[jobs.fn[job]];
+            double exact = fn->primitive(jobs.b[job]) - fn->primitive(jobs.a[job]);
+            printf("%d %s [%g, %g] n = %lld: %.15f error %.3e\n", job + 1, fn->name, jobs.a[job], jobs.b[job],
+                   jobs.n[job], total[job], fabs(total[job] - exact));
+        }
+        printf("number of processes: %d\n", size);
+        printf("jobs: %d\n", count);
+        printf("time: %.6f seconds\n", t1 - t0);
+        printf("jobs per second: %.1f\n", count / (t1 - t0));
+    }
+    free(total);
+    jobs_free(&jobs);
+    return 0;
+}
+
+// --- Масштабирование ---
+// Прогон трапеций на первых p рангах, p = 1, 2, 4, ... и size: сильное
+// масштабирование держит n, слабое растит его как n * p. Каждый ранг
+// меряет счёт, ожидание на барьере (это его недогрузка) и MPI_Reduce после
+// барьера; ранг 0 собирает времена через MPI_Gather. Из reps повторов
+// берётся самый быстрый, ускорение и эффективность — против p = 1.
+#define BENCH_MAX_N 16
+
+static int parse_sizes(const char *text, long long *out) {
+    int count = 0;
+    char *end;
+    while (count < BENCH_MAX_N) {
+        double v = strtod(text, &end);
+        if (end == text || v < 1) return 0;
+        out[count++] = (long long)v;
+        if (*end != ',') break;
+        text = end + 1;
+    }
+    return *end == '\0' ? count : 0;
+}
+
+typedef struct {
+    double total;                // максимум по рангам
+    double compute_max, compute_mean, barrier_max, reduce_max;
+} BenchTimes;
 
+static void bench_once(MPI_Comm comm, long long n, BenchTimes *out) {
     int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    double a = 0.0, b = M_PI, h = (b - a) / (double)n;
+    long long start, local_n;
+    split_work(n, size, rank, &start, &local_n);
+
+    MPI_Barrier(comm);
+    double t0 = MPI_Wtime();
+    double sum = sum_points(&integrands[0], a, h, start, start + local_n);
+    if (local_n > 0 && start == 0) sum -= f(a) / 2.0;
+    if (local_n > 0 && start + local_n == n) sum += f(b) / 2.0;
+    double local = sum * h, total;
+    double t1 = MPI_Wtime();
+    MPI_Barrier(comm);
+    double t2 = MPI_Wtime();
+    MPI_Reduce(&local, &total, 1, MPI_DOUBLE, MPI_SUM, 0, comm);
+    double t3 = MPI_Wtime();
+
+    double phases[4] = {t1 - t0, t2 - t1, t3 - t2, t3 - t0};
+    double *all = rank == 0 ? malloc(4 * size * sizeof(double)) : NULL;
+    MPI_Gather(phases, 4, MPI_DOUBLE, all, 4, MPI_DOUBLE, 0, comm);
+    if (rank == 0) {
+        memset(out, 0, sizeof(*out));
+        for (int r = 0; r < size; ++r) {
+            const double *p = all + 4 * r;
+            out->compute_max = p[0] > out->compute_max ? p[0] : out->compute_max;
+            out->compute_mean += p[0] / size;
+            out->barrier_max = p[1] > out->barrier_max ? p[1] : out->barrier_max;
+            out->reduce_max = p[2] > out->reduce_max ? p[2] : out->reduce_max;
+            out->total = p[3] > out->total ? p[3] : out->total;
+        }
+        free(all);
+    }
+}
+
+static void run_bench(int argc, char *argv[], int rank, int size) {
+    long long sizes[BENCH_MAX_N] = {10000000LL, 100000000LL};
+    int num_sizes = 2, reps = 3, strong = 1, weak = 1;
+    const char *out_path = NULL;
+    for (int i = 0; i < argc; i += 2) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        int ok = value != NULL;
+        if (ok && strcmp(argv[i], "--n") == 0)
+            ok = (num_sizes = parse_sizes(value, sizes)) > 0;
+        else if (ok && strcmp(argv[i], "--reps") == 0)
+            ok = (reps = atoi(value)) > 0;
+        else if (ok && strcmp(argv[i], "--mode") == 0) {
+            strong = strcmp(value, "strong") == 0 || strcmp(value, "both") == 0;
+            weak = strcmp(value, "weak") == 0 || strcmp(value, "both") == 0;
+            ok = strong || weak;
+        } else if (ok && strcmp(argv[i], "--out") == 0)
+            out_path = value;
+        else
+            ok = 0;
+        if (!ok) {
+            if (rank == 0)
+                printf("usage: mpirun -np P ./3 bench [--n 1e7,1e8] [--mode strong|weak|both] [--reps 3] [--out FILE]\n");
+            return;
+        }
+    }
+    FILE *out = stdout;
+    if (rank == 0 && out_path && !(out = fopen(out_path, "w"))) {
+        perror(out_path);
+        out = stdout;
+    }
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    if (rank == 0)
+        fprintf(out, "mode,ranks,threads,n,time,compute_max,compute_mean,barrier_max,reduce_max,"
+                     "imbalance,speedup,efficiency\n");
 
+    for (int mode = 0; mode < 2; ++mode) {
+        if ((mode == 0 && !strong) || (mode == 1 && !weak)) continue;
+        for (int s = 0; s < num_sizes; ++s) {
+            double baseline = 0.0;
+            for (int p = 1; p <= size; p = p < size && 2 * p > size ? size : 2 * p) {
+                MPI_Comm comm;
+                MPI_Comm_split(MPI_COMM_WORLD, rank < p ? 0 : MPI_UNDEFINED, rank, &comm);
+                long long n = mode == 0 ? sizes[s] : sizes[s] * p;
+                BenchTimes best = {0}, cur;
+                if (comm != MPI_COMM_NULL) {
+                    for (int r = 0; r < reps; ++r) {
+                        bench_once(comm, n, &cur);
+                        if (r == 0 || cur.total < best.total) best = cur;
+                    }
+                    MPI_Comm_free(&comm);
+                }
+                if (rank == 0) {
+                    if (p == 1) baseline = best.total;
+                    // При слабом масштабировании работа растёт с p
+                    double speedup = baseline / best.total * (mode == 0 ? 1 : p);
+                    fprintf(out, "%s,%d,%d,%lld,%.6f,%.6f,%.6f,%.6f,%.6f,%.3f,%.3f,%.3f\n",
+                            mode == 0 ? "strong" : "weak", p, threads, n, best.total, best.compute_max,
+                            best.compute_mean, best.barrier_max, best.reduce_max,
+                            best.compute_mean > 0 ? best.compute_max / best.compute_mean : 1.0, speedup,
+                            speedup / p);
+                    fflush(out);
+                }
+                if (p == size) break;
+            }
+        }
+    }
+    if (out != stdout) fclose(out);
+}
+
+// --- Квази-Монте-Карло ---
+// Точки Хэлтона в [0,1]^dim: координата j — обращение цифр номера по
+// простому основанию p_j. Цифры разряда k переставляются случайной
+// перестановкой своей для каждой пары (j, k) и каждой реплики; по разбросу
+// реплик оценивается ошибка. Номер точки хранится одометром цифр, а
+// координата — целым sum perm(d_k) * p^(K-1-k) < 2^53, так что соседняя
+// точка получается за O(1) в среднем без накопления ошибки. Ранг берёт
+// свой отрезок номеров и переходит к нему сразу, без обменов; точки
+// считаются порциями по QMC_BLOCK, по столбцу на измерение.
+#define QMC_MAX_DIM 50
+#define QMC_BLOCK 256
+
+static const int primes[QMC_MAX_DIM] = {
+    2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59,
+    61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131, 137,
+    139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223, 227, 229};
+
+typedef struct {
+    int dim;
+    int digits[QMC_MAX_DIM];     // K_j: наибольшее с p^K <= 2^53
+    double scale[QMC_MAX_DIM];   // p^-K
+    long long weight[QMC_MAX_DIM][64];
+    unsigned char *perm[QMC_MAX_DIM];  // [k * 256 + d]
+} Halton;
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void halton_init(Halton *h, int dim, uint64_t seed) {
+    h->dim = dim;
+    for (int j = 0; j < dim; ++j) {
+        int p = primes[j], k = 0;
+        long long power = 1;
+        while (power <= (1LL << 53) / p) {
+            power *= p;
+            k++;
+        }
+        h->digits[j] = k;
+        h->scale[j] = 1.0 / (double)power;
+        for (int i = 0; i < k; ++i) {
+            power /= p;
+            h->weight[j][i] = power;
+        }
+        // Перестановки Фишера-Йетса; реплика задаётся seed
+        h->perm[j] = malloc(k * 256);
+        for (int i = 0; i < k; ++i) {
+            unsigned char *perm = h->perm[j] + i * 256;
+            for (int d = 0; d < p; ++d) perm[d] = (unsigned char)d;
+            for (int d = p - 1; d > 0; --d) {
+                int e = (int)(splitmix64(&seed) % (uint64_t)(d + 1));
+                unsigned char t = perm[d];
+                perm[d] = perm[e];
+                perm[e] = t;
+            }
+        }
+    }
+}
+
+static void halton_free(Halton *h) {
+    for (int j = 0; j < h->dim; ++j) free(h->perm[j]);
+}
+
+// Координаты точек first .. first + count - 1 в x[j * QMC_BLOCK + i]
+static void halton_block(const Halton *h, long long first, int count, double *x) {
+    unsigned char digit[64];
+    for (int j = 0; j < h->dim; ++j) {
+        int p = primes[j], k = h->digits[j];
+        const unsigned char *perm = h->perm[j];
+        const long long *w = h->weight[j];
+        // Переход к номеру first: его цифры и значение
+        long long index = first, value = 0;
+        for (int i = 0; i < k; ++i) {
+            digit[i] = (unsigned char)(index % p);
+            index /= p;
+            value += perm[i * 256 + digit[i]] * w[i];
+        }
+        for (int n = 0; n < count; ++n) {
+            x[j * QMC_BLOCK + n] = value * h->scale[j];
+            // Прибавление единицы с переносом
+            for (int i = 0; i < k; ++i) {
+                int d = digit[i] + 1 == p ? 0 : digit[i] + 1;
+                value += (perm[i * 256 + d] - perm[i * 256 + digit[i]]) * w[i];
+                digit[i] = (unsigned char)d;
+                if (d != 0) break;
+            }
+        }
+    }
+}
+
+// Функции на [0,1]^dim: столбцы x по QMC_BLOCK, результат в y[0 .. count)
+static void gfunc_block(const double *x, int dim, int count, double *y) {
+    for (int n = 0; n < count; ++n) y[n] = 1.0;
+    for (int j = 0; j < dim; ++j) {
+        const double *col = x + j * QMC_BLOCK;
+        double a = j + 1;
+        for (int n = 0; n < count; ++n) y[n] *= (fabs(4.0 * col[n] - 2.0) + a) / (1.0 + a);
+    }
+}
+
+static double gfunc_exact(int dim) {
+    (void)dim;
+    return 1.0;
+}
+
+static void gauss_block(const double *x, int dim, int count, double *y) {
+    for (int n = 0; n < count; ++n) y[n] = 0.0;
+    for (int j = 0; j < dim; ++j) {
+        const double *col = x + j * QMC_BLOCK;
+        for (int n = 0; n < count; ++n) y[n] += col[n] * col[n];
+    }
+    for (int n = 0; n < count; ++n) y[n] = exp(-y[n]);
+}
+
+static double gauss_exact(int dim) {
+    return pow(sqrt(M_PI) / 2.0 * erf(1.0), dim);
+}
+
+static void sumsq_block(const double *x, int dim, int count, double *y) {
+    for (int n = 0; n < count; ++n) y[n] = 0.0;
+    for (int j = 0; j < dim; ++j) {
+        const double *col = x + j * QMC_BLOCK;
+        for (int n = 0; n < count; ++n) y[n] += col[n];
+    }
+    for (int n = 0; n < count; ++n) y[n] *= y[n];
+}
+
+static double sumsq_exact(int dim) {
+    return dim / 3.0 + dim * (dim - 1) / 4.0;
+}
+
+typedef struct {
+    const char *name;
+    void (*block)(const double *x, int dim, int count, double *y);
+    double (*exact)(int dim);
+} CubeIntegrand;
+
+static const CubeIntegrand cube_integrands[] = {
+    {"gfunc", gfunc_block, gfunc_exact},   // prod (|4x - 2| + j) / (1 + j)
+    {"gauss", gauss_block, gauss_exact},   // exp(-|x|^2)
+    {"sumsq", sumsq_block, sumsq_exact},   // (sum x)^2
+};
+#define NUM_CUBE_INTEGRANDS (int)(sizeof(cube_integrands) / sizeof(cube_integrands[0]))
+
+// Сумма по точкам [first, last) одной реплики
+static double qmc_sum(const CubeIntegrand *fn, const Halton *h, long long first, long long last) {
+    long long blocks = (last - first + QMC_BLOCK - 1) / QMC_BLOCK;
+    double sum = 0.0;
+    #pragma omp parallel reduction(+:sum)
+    {
+        double *x = malloc(h->dim * QMC_BLOCK * sizeof(double)), y[QMC_BLOCK];
+        #pragma omp for schedule(static)
+        for (long long blk = 0; blk < blocks; ++blk) {
+            long long i = first + blk * QMC_BLOCK;
+            int count = last - i < QMC_BLOCK ? (int)(last - i) : QMC_BLOCK;
+            halton_block(h, i, count, x);
+            fn->block(x, h->dim, count, y);
+            for (int n = 0; n < count; ++n) sum += y[n];
+        }
+        free(x);
+    }
+    return sum;
+}
+
+static void run_qmc(int argc, char *argv[], int rank, int size) {
+    const CubeIntegrand *fn = &cube_integrands[0];
+    int dim = 10, reps = 8;
+    long long n = 1000000;
+    uint64_t seed = 1;
+    for (int i = 0; i < argc; i += 2) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        int ok = value != NULL;
+        if (ok && strcmp(argv[i], "--f") == 0) {
+            ok = 0;
+            for (int k = 0; k < NUM_CUBE_INTEGRANDS; ++k)
+                if (strcmp(cube_integrands[k].name, value) == 0) {
+                    fn = &cube_integrands[k];
+                    ok = 1;
+                }
+        } else if (ok && strcmp(argv[i], "--dim") == 0)
+            ok = (dim = atoi(value)) >= 1 && dim <= QMC_MAX_DIM;
+        else if (ok && strcmp(argv[i], "--n") == 0)
+            ok = (n = (long long)atof(value)) > 0;
+        else if (ok && strcmp(argv[i], "--reps") == 0)
+            ok = (reps = atoi(value)) >= 2;
+        else if (ok && strcmp(argv[i], "--seed") == 0)
+            seed = strtoull(value, NULL, 10);
+        else
+            ok = 0;
+        if (!ok) {
+            if (rank == 0)
+                printf("usage: mpirun -np P ./3 qmc [--f gfunc|gauss|sumsq] [--dim 1..%d] [--n 1e6] [--reps 8] [--seed 1]\n",
+                       QMC_MAX_DIM);
+            return;
+        }
+    }
+    double t0 = MPI_Wtime();
+    long long start, local_n;
+    split_work(n, size, rank, &start, &local_n);
+    double *local = malloc(reps * sizeof(double)), *total = malloc(reps * sizeof(double));
+    for (int r = 0; r < reps; ++r) {
+        Halton h;
+        halton_init(&h, dim, seed * 0x9E3779B97F4A7C15ULL + r);
+        local[r] = qmc_sum(fn, &h, start, start + local_n);
+        halton_free(&h);
+    }
+    MPI_Reduce(local, total, reps, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    double t1 = MPI_Wtime();
+
+    if (rank == 0) {
+        // Реплики независимы: среднее и его стандартная ошибка
+        double mean = 0.0, var = 0.0;
+        for (int r = 0; r < reps; ++r) mean += total[r] / n / reps;
+        for (int r = 0; r < reps; ++r) var += (total[r] / n - mean) * (total[r] / n - mean) / (reps - 1);
+        double exact = fn->exact(dim);
+        printf("metod kvazi-Monte-Karlo (Halton, scrambled)\n");
+        printf("integral of %s over [0, 1]^%d = %.15f\n", fn->name, dim, mean);
+        printf("exact value: %.15f\n", exact);
+        printf("error: %.15e\n", fabs(mean - exact));
+        printf("standard error: %.15e (%d replicates)\n", sqrt(var / reps), reps);
+        printf("number of processes: %d\n", size);
+        printf("points: %lld x %d\n", n, reps);
+        printf("time: %.6f seconds\n", t1 - t0);
+    }
+    free(local);
+    free(total);
+}
+
+static void run_trapezoid(int argc, char *argv[], int rank, int size) {
     double a = 0.0, b = M_PI;   
     long long n = 100000000LL;
     
@@ -43,14 +1004,11 @@ int main(int argc, char *argv[]) {
     long long start_idx, local_n;
     split_work(n, size, rank, &start_idx, &local_n);
 
-    double local_sum = 0.0;
+    // Процесс берёт левые концы своих интервалов; крайние точки с весом 1/2
     long long end_idx = start_idx + local_n;
-
-    for (long long i = start_idx; i < end_idx; ++i) {
-        double x_left = a + i * h;
-        double x_right = a + (i + 1) * h;
-        local_sum += (f(x_left) + f(x_right)) / 2.0;
-    }
+    double local_sum = sum_points(&integrands[0], a, h, start_idx, end_idx);
+    if (local_n > 0 && start_idx == 0) local_sum -= f(a) / 2.0;
+    if (local_n > 0 && end_idx == n) local_sum += f(b) / 2.0;
     double local_integral = local_sum * h;
 
     double total_integral = 0.0;
@@ -59,7 +1017,7 @@ int main(int argc, char *argv[]) {
     double t1 = MPI_Wtime(); 
 
     if (rank == 0) {
-        double exact = 2.0;
+        double exact = cos(a) - cos(b);
         double err = fabs(total_integral - exact);
         printf("metod trpezii\n");
         printf("integral of sin(x) on [%.7f, %.6f] = %.15f\n", a, b, total_integral);
@@ -67,9 +1025,35 @@ int main(int argc, char *argv[]) {
         printf("error: %.15e\n", err);
         printf("computed value: %.15f\n", total_integral); 
         printf("number of processes: %d\n", size);
+#ifdef _OPENMP
+        printf("threads per process: %d\n", omp_get_max_threads());
+#endif
         printf("number of intervals: %lld\n", n);
         printf("time: %.6f seconds\n", t1 - t0);
     }
+}
+
+int main(int argc, char *argv[]) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int status = 0;
+    if (argc > 1 && strcmp(argv[1], "adapt") == 0)
+        status = run_adapt(argc - 2, argv + 2, rank, size);
+    else if (argc > 1 && strcmp(argv[1], "romberg") == 0)
+        run_romberg(argc - 2, argv + 2, rank, size);
+    else if (argc > 1 && strcmp(argv[1], "batch") == 0)
+        status = run_batch(argc - 2, argv + 2, rank, size);
+    else if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        run_bench(argc - 2, argv + 2, rank, size);
+    else if (argc > 1 && strcmp(argv[1], "qmc") == 0)
+        run_qmc(argc - 2, argv + 2, rank, size);
+    else
+        run_trapezoid(argc, argv, rank, size);
     MPI_Finalize();
-    return 0;
+    return status;
 }
\ No newline at end of file